@@ -4,25 +4,51 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <concepts>
 #include <format>
 #include <functional>
 #include <initializer_list>
+#include <mutex>
 #include <optional>
+#include <ranges>
+#include <source_location>
 #include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <ruby.h>
 #include <ruby/encoding.h>
+#include <ruby/fiber/scheduler.h>
+#include <ruby/io.h>
 #include <ruby/io/buffer.h>
 #include <ruby/thread.h>
+#include <ruby/vm.h>
+
+#ifdef RCX_URING
+#include <liburing.h>
+#endif
 
 #define rcx_assert(expr) assert((expr))
 #define rcx_delete(reason) delete
 
+// The call site of the functions that release the GVL, by which the GVL statistics are aggregated.
+// The parameter is left out of the signatures unless the statistics are collected.
+#ifdef RCX_GVL_STATS
+#define RCX_LOCATION_PARAM , std::source_location location = std::source_location::current()
+#define RCX_LOCATION_DEF , std::source_location location
+#define RCX_LOCATION_ARG , location
+#else
+#define RCX_LOCATION_PARAM
+#define RCX_LOCATION_DEF
+#define RCX_LOCATION_ARG
+#endif
+
 #ifdef HAVE_FEATURE_NULLABILITY
 #define RCX_Nullable _Nullable
 #define RCX_Nonnull _Nonnull
@@ -40,6 +66,7 @@
 namespace rcx {
   class Ruby;
   class Id;
+  class Yielder;
 
   /// Value wrappers.
   ///
@@ -84,6 +111,12 @@ namespace rcx {
   ///
   /// @internal
   namespace detail {
+    template <typename... Args> class DeferredFormat;
+
+    template <typename T>
+    using deferred_arg_t = std::conditional_t<std::is_convertible_v<T const &, std::string_view>,
+        std::string, std::decay_t<T>>;
+
     template <typename T> struct unsafe_coerce {
       VALUE value;
 
@@ -292,7 +325,42 @@ namespace rcx {
     };
   }
 
+  /// Maps C++ enumerators to Ruby symbols.
+  ///
+  /// Specialize this template to make an enum type convertible from and into `Symbol`s. The
+  /// specialization must have a static constexpr member `symbols`, an array of pairs of an
+  /// enumerator and its name:
+  ///
+  /// ```cpp
+  /// template <> struct rcx::EnumTraits<Mode> {
+  ///   static constexpr std::array symbols{
+  ///     std::pair{Mode::Fast, "fast"},
+  ///     std::pair{Mode::Small, "small"},
+  ///   };
+  /// };
+  /// ```
+  template <typename E> struct EnumTraits {};
+
+  namespace concepts {
+    /// Specifies the enum types mapped to Ruby symbols by \ref rcx::EnumTraits.
+    ///
+    template <typename E>
+    concept SymbolEnum = std::is_enum_v<E> && requires {
+      { std::size(EnumTraits<E>::symbols) } -> std::convertible_to<size_t>;
+      { EnumTraits<E>::symbols[0].first } -> std::convertible_to<E>;
+      { EnumTraits<E>::symbols[0].second } -> std::convertible_to<std::string_view>;
+    };
+  }
+
   namespace convert {
+    template <concepts::SymbolEnum E> struct FromValue<E> {
+      E convert(Value value);
+    };
+
+    template <concepts::SymbolEnum E> struct IntoValue<E> {
+      Value convert(E value);
+    };
+
     template <concepts::ConvertibleFromValue T> struct FromValue<std::optional<T>> {
       decltype(auto) convert(Value v);
     };
@@ -343,6 +411,16 @@ namespace rcx {
       static ResultType parse(Ruby &, Value self, std::span<Value> &args);
     };
 
+    struct YieldBlock {
+      using ResultType = Yielder;
+      static ResultType parse(Ruby &, Value self, std::span<Value> &args);
+    };
+
+    struct YieldBlockOpt {
+      using ResultType = std::optional<Yielder>;
+      static ResultType parse(Ruby &, Value self, std::span<Value> &args);
+    };
+
     /// The method receiver.
     ///
     /// The method accepts the method receiver and converts it into type T.
@@ -364,6 +442,14 @@ namespace rcx {
     /// Optional block.
     ///
     constexpr inline BlockOpt block_opt;
+    /// Block that is only yielded to.
+    ///
+    /// Unlike \ref block, this does not create a `Proc` object.
+    constexpr inline YieldBlock yield_block;
+    /// Optional block that is only yielded to.
+    ///
+    /// Unlike \ref block_opt, this does not create a `Proc` object.
+    constexpr inline YieldBlockOpt yield_block_opt;
   }
 
   namespace concepts {
@@ -424,11 +510,21 @@ namespace rcx {
     /// Creates a mutable `String` in UTF-8 encoding.
     ///
     template <detail::u8cxstring> String operator""_str();
+    /// Creates a mutable `String` in ASCII-8BIT encoding that refers to the literal's storage.
+    ///
+    /// The content is not copied until the `String` is modified.
+    template <detail::cxstring> String operator""_sstr();
+    /// Creates a mutable `String` in UTF-8 encoding that refers to the literal's storage.
+    ///
+    /// The content is not copied until the `String` is modified.
+    template <detail::u8cxstring> String operator""_sstr();
     /// Creates a frozen `String` in ASCII-8BIT encoding.
     ///
+    /// The `String` is created once per literal and never garbage-collected.
     template <detail::cxstring> String operator""_fstr();
     /// Creates a frozen `String` in UTF-8 encoding.
     ///
+    /// The `String` is created once per literal and never garbage-collected.
     template <detail::u8cxstring> String operator""_fstr();
     /// Creates a `Symbol` for the name encoded in ASCII/ASCII-8BIT.
     ///
@@ -771,6 +867,39 @@ namespace rcx {
           std::invocable<T const &, typename ArgSpec::ResultType...> auto &&function,
           ArgSpec... argspec) const;
 
+      /// Defines an attribute reader for a data member.
+      ///
+      /// The reader can be called even when the object is frozen. Unlike \ref define_method, the
+      /// method does not allocate any resource.
+      /// @tparam Member The pointer to the data member.
+      /// @param name The name of the attribute.
+      /// @return Self.
+      template <auto Member>
+        requires std::is_member_object_pointer_v<decltype(Member)>
+      ClassT<T> define_attr_reader(concepts::Identifier auto &&name) const;
+
+      /// Defines an attribute writer for a data member.
+      ///
+      /// The method is named `name=` and will raise a `FrozenError` if the object is frozen.
+      /// Unlike \ref define_method, the method does not allocate any resource.
+      /// @tparam Member The pointer to the data member.
+      /// @param name The name of the attribute.
+      /// @return Self.
+      template <auto Member>
+        requires std::is_member_object_pointer_v<decltype(Member)>
+      ClassT<T> define_attr_writer(concepts::Identifier auto &&name) const;
+
+      /// Defines an attribute reader and writer for a data member.
+      ///
+      /// @tparam Member The pointer to the data member.
+      /// @param name The name of the attribute.
+      /// @return Self.
+      /// @sa define_attr_reader
+      /// @sa define_attr_writer
+      template <auto Member>
+        requires std::is_member_object_pointer_v<decltype(Member)>
+      ClassT<T> define_attr_accessor(concepts::Identifier auto &&name) const;
+
       /// Defines `initialize` method using a C++ constructor.
       ///
       /// @param argspec List of argument specifications.
@@ -820,6 +949,9 @@ namespace rcx {
 
       /// Creates a `Symbol` from a string view.
       ///
+      /// The name is resolved into a static ID at most once per process and cached, so the
+      /// symbol is never garbage-collected.
+      ///
       /// @param sv The string view.
       explicit Symbol(std::string_view sv) noexcept;
 
@@ -861,6 +993,15 @@ namespace rcx {
       /// @return The created mutable `String`.
       template <concepts::CharLike CharT> static String copy_from(CharT const *RCX_Nonnull s);
 
+      /// Creates a mutable `String` that refers to the storage of a C++ string-like object
+      /// without copying.
+      ///
+      /// The content is copied only when the `String` is modified.
+      /// @warning The storage must be valid for the rest of the program, e.g. a string literal.
+      /// @param s The C++ string-like object.
+      /// @return The created mutable `String`.
+      template <concepts::StringLike S> static String new_static(S &&s);
+
       /// Returns the length of the string in octets.
       ///
       /// @return The length of the string in octets.
@@ -891,6 +1032,29 @@ namespace rcx {
       ///
       /// @return The unlocked string.
       String unlock() const;
+
+      /// Creates a substring by a range in octets.
+      ///
+      /// The substring is usually a copy. Ruby shares the storage only with a substring that
+      /// extends to the end of this string and is too long to be embedded, and this string is then
+      /// made to share its storage as well, if not yet. A shared substring must be modified
+      /// through Ruby methods, which copy the bytes first, and not by writing through \ref data.
+      ///
+      /// @param offset The offset of the substring in octets.
+      /// @param length The length of the substring in octets.
+      /// @return The created mutable substring.
+      /// @throws IndexError When the range is out of the string.
+      String subseq(size_t offset, size_t length) const;
+
+      /// Creates substrings by ranges in octets.
+      ///
+      /// This is the bulk version of \ref subseq. All the ranges are checked before any
+      /// substring is created.
+      ///
+      /// @param ranges The pairs of the offset and the length of the substrings in octets.
+      /// @return The `Array` of the created mutable substrings.
+      /// @throws IndexError When any of the ranges is out of the string.
+      Array subseq(std::span<std::pair<size_t, size_t> const> ranges) const;
     };
 
     /// Represents a Ruby `Array`.
@@ -995,6 +1159,26 @@ namespace rcx {
       /// @param args The arguments to pass to the `Proc`.
       /// @return The result of calling the `Proc`.
       Value call(Array args) const;
+
+      /// Calls this `Proc` with the given arguments without allocating an `Array`.
+      ///
+      /// A single `Array` argument is passed as the argument list, not as an argument, by the
+      /// overload above.
+      ///
+      /// @tparam R The type the result should be converted into.
+      /// @param args The arguments to pass to the `Proc`.
+      /// @return The result of calling the `Proc`.
+      template <concepts::ConvertibleFromValue R = Value>
+      R call(concepts::ConvertibleIntoValue auto &&...args) const;
+
+      /// Calls this `Proc` with the given arguments and a block.
+      ///
+      /// @tparam R The type the result should be converted into.
+      /// @param block The block to pass to the `Proc`.
+      /// @param args The arguments to pass to the `Proc`.
+      /// @return The result of calling the `Proc`.
+      template <concepts::ConvertibleFromValue R = Value>
+      R call_with_block(Proc block, concepts::ConvertibleIntoValue auto &&...args) const;
     };
 
     /// Represents a Ruby exception.
@@ -1008,6 +1192,7 @@ namespace rcx {
       ///
       /// This method creates an exception instance with a formatted message using C++20 std::format
       /// syntax. The message is created as a frozen string and passed to the exception constructor.
+      /// The message is not interned, so unique messages do not accumulate in the VM.
       ///
       /// @tparam E The type of exception class (must be derived from Exception).
       /// @tparam Args The argument types for the format string.
@@ -1018,6 +1203,35 @@ namespace rcx {
       template <std::derived_from<Exception> E, typename... Args>
       static E format(ClassT<E> cls, std::format_string<Args...> fmt, Args &&...args);
 
+      /// Creates a C++ exception that raises a formatted exception of the specified type.
+      ///
+      /// Unlike \ref format, neither the message nor the Ruby exception is created until the
+      /// exception escapes to Ruby or its message is read. This makes it cheap to throw
+      /// exceptions that are usually caught in C++.
+      ///
+      /// The arguments are copied into the exception, and strings are copied as `std::string`.
+      /// Ruby values cannot be used as arguments, since they are not protected from GC while
+      /// the exception is in flight.
+      ///
+      /// Creating the exception does not call Ruby, so it can also be thrown from a callback of
+      /// \ref rcx::gvl::without_gvl.
+      ///
+      /// @warning The exception holds the class without marking it. The class must be kept alive
+      /// by other means while the exception is in flight, as the builtin classes and the classes
+      /// defined with \ref rcx::Ruby::define_class are. Keep any other class in a \ref rcx::Leak.
+      ///
+      /// @tparam E The type of exception class (must be derived from Exception).
+      /// @tparam Args The argument types for the format string.
+      /// @param cls The exception class to instantiate.
+      /// @param fmt The format string (follows std::format syntax).
+      /// @param args The arguments to format into the string.
+      /// @return The C++ exception to be thrown.
+      /// @sa rcx::DeferredException
+      template <std::derived_from<Exception> E, typename... Args>
+        requires(!std::derived_from<std::remove_cvref_t<Args>, ValueBase> && ...)
+      static detail::DeferredFormat<detail::deferred_arg_t<Args>...> deferred(
+          ClassT<E> cls, std::format_string<Args...> fmt, Args &&...args);
+
       /// Creates a `SystemCallError` from an errno value.
       ///
       /// This method creates a SystemCallError exception based on the provided errno value.
@@ -1050,6 +1264,125 @@ namespace rcx {
       ///
       /// @throws IOError If the IO object is not writable.
       void check_writable() const;
+
+      /// Events to wait for with \ref wait.
+      ///
+      enum class Events : int {
+        /// The IO is readable.
+        Readable = RUBY_IO_READABLE,
+        /// The IO has priority data to read.
+        Priority = RUBY_IO_PRIORITY,
+        /// The IO is writable.
+        Writable = RUBY_IO_WRITABLE,
+      };
+
+      /// Bitwise OR operator for Events.
+      friend constexpr Events operator|(Events lhs, Events rhs) noexcept {
+        return static_cast<Events>(static_cast<int>(lhs) | static_cast<int>(rhs));
+      }
+
+      /// Bitwise AND operator for Events.
+      friend constexpr Events operator&(Events lhs, Events rhs) noexcept {
+        return static_cast<Events>(static_cast<int>(lhs) & static_cast<int>(rhs));
+      }
+
+      /// Waits until the IO is ready for any of the events.
+      ///
+      /// The wait is done with `rb_io_wait`, so it yields to the fiber scheduler if one is set,
+      /// and otherwise lets other threads run.
+      ///
+      /// @param events The events to wait for.
+      /// @param timeout The time to wait. If not given, the timeout of the IO (`IO#timeout`) is
+      ///   used, which waits forever if it is not set.
+      /// @return The events that are ready, or no events if the wait timed out.
+      /// @throws IOError If the IO is closed.
+      Events wait(Events events,
+          std::optional<std::chrono::nanoseconds> timeout = std::nullopt) const;
+
+#ifdef RCX_IO_BUFFER
+      /// Reads from the file at the given position into the whole `IO::Buffer`.
+      ///
+      /// Partial reads are retried until the buffer is filled or the end of the file is reached.
+      /// The GVL is released while reading, and the read can be interrupted by other threads.
+      /// The buffer is locked during the read. When a fiber scheduler is set, its `io_pread`
+      /// hook is used instead.
+      ///
+      /// @param buffer The buffer to read into.
+      /// @param offset The position in the file to read from.
+      /// @param location The call site, which the GVL statistics are aggregated by.
+      ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+      /// @return The number of bytes read, which is less than the size of the buffer only at the
+      ///   end of the file.
+      /// @throws SystemCallError If the read fails.
+      /// @throws IO::TimeoutError If `IO#timeout` expires while waiting for the IO to be ready.
+      size_t pread_into(IOBuffer buffer, size_t offset RCX_LOCATION_PARAM) const;
+
+      /// Writes the whole `IO::Buffer` to the file at the given position.
+      ///
+      /// Partial writes are retried until the whole buffer is written. The GVL is released while
+      /// writing, and the write can be interrupted by other threads. The buffer is locked during
+      /// the write. When a fiber scheduler is set, its `io_pwrite` hook is used instead.
+      ///
+      /// @param buffer The buffer to write from.
+      /// @param offset The position in the file to write to.
+      /// @param location The call site, which the GVL statistics are aggregated by.
+      ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+      /// @return The number of bytes written.
+      /// @throws SystemCallError If the write fails.
+      /// @throws IO::TimeoutError If `IO#timeout` expires while waiting for the IO to be ready.
+      size_t pwrite_from(IOBuffer buffer, size_t offset RCX_LOCATION_PARAM) const;
+#endif
+
+      /// Writes the Strings with vectored writes, without concatenating them.
+      ///
+      /// The bytes of the Strings are pinned and written with `writev` without the GVL, up to
+      /// 256 or `IOV_MAX` Strings per system call. Partial writes are retried until all the bytes
+      /// are written. The internal write buffer of the IO is flushed first.
+      ///
+      /// Mutable Strings are locked while they are written. Frozen Strings are not locked, so
+      /// that threads can write the same frozen String at once.
+      ///
+      /// @param strings The Strings to write.
+      /// @param location The call site, which the GVL statistics are aggregated by.
+      ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+      /// @return The number of bytes written.
+      /// @throws RuntimeError If a mutable String is locked, e.g. while another thread writes it.
+      /// @throws SystemCallError If the write fails.
+      /// @throws IO::TimeoutError If `IO#timeout` expires while waiting for the IO to be ready.
+      size_t writev(std::span<String const> strings RCX_LOCATION_PARAM) const;
+
+      /// Writes the Strings in an Array with vectored writes, without concatenating them.
+      ///
+      /// @param strings The Array of Strings to write.
+      /// @param location The call site, which the GVL statistics are aggregated by.
+      ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+      /// @return The number of bytes written.
+      /// @throws TypeError If an element is not a String.
+      /// @throws RuntimeError If a mutable String is locked, e.g. while another thread writes it.
+      /// @throws SystemCallError If the write fails.
+      /// @throws IO::TimeoutError If `IO#timeout` expires while waiting for the IO to be ready.
+      size_t writev(
+          Array strings RCX_LOCATION_PARAM) const;
+
+      /// Copies a range of a file to another IO in the kernel.
+      ///
+      /// The bytes are copied with `copy_file_range` or `sendfile` if available, falling back to
+      /// reading and writing through a small buffer, without the GVL. Partial transfers are
+      /// resumed, and the copy waits for `to` to be writable if it is non-blocking. The internal
+      /// write buffer of `to` is flushed first. A file opened for appending is always written
+      /// through the buffer, as the kernel copies do not support it.
+      ///
+      /// @param from The file to copy from. The file position is not changed.
+      /// @param to The IO to copy to, such as a socket. The bytes are written at its position.
+      /// @param offset The position in `from` to copy from.
+      /// @param length The number of bytes to copy.
+      /// @param location The call site, which the GVL statistics are aggregated by.
+      ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+      /// @return The number of bytes copied, which is less than `length` only at the end of
+      ///   `from`.
+      /// @throws SystemCallError If the copy fails.
+      /// @throws IO::TimeoutError If `IO#timeout` expires while waiting for the IO to be ready.
+      static size_t copy_range(IO from, IO to, size_t offset, size_t length RCX_LOCATION_PARAM);
     };
 
 #ifdef RCX_IO_BUFFER
@@ -1069,6 +1402,47 @@ namespace rcx {
       /// @param size The size of the buffer.
       /// @return The newly created buffer.
       static IOBuffer new_mapped(size_t size);
+
+      /// Flags for \ref map_file.
+      ///
+      enum class MapFlags : int {
+        /// Maps the file read-only.
+        ReadOnly = 0,
+        /// Maps the file copy-on-write. Writes to the buffer are not written back to the file.
+        Private = 1,
+        /// Hints that the pages will be accessed sequentially.
+        Sequential = 2,
+        /// Hints that the pages will be accessed soon.
+        WillNeed = 4,
+        /// Hints that the mapping should be backed by huge pages.
+        HugePage = 8,
+      };
+
+      /// Bitwise OR operator for MapFlags.
+      friend constexpr MapFlags operator|(MapFlags lhs, MapFlags rhs) noexcept {
+        return static_cast<MapFlags>(static_cast<int>(lhs) | static_cast<int>(rhs));
+      }
+
+      /// Bitwise AND operator for MapFlags.
+      friend constexpr MapFlags operator&(MapFlags lhs, MapFlags rhs) noexcept {
+        return static_cast<MapFlags>(static_cast<int>(lhs) & static_cast<int>(rhs));
+      }
+
+      /// Creates an `IO::Buffer` that maps a file into memory.
+      ///
+      /// The file is mapped read-only unless `MapFlags::Private` is given. The access pattern
+      /// hints are passed to `madvise` where available; failures to apply them are ignored.
+      /// The mapped bytes can be viewed with \ref cbytes without copying.
+      ///
+      /// @param io The file to be mapped.
+      /// @param offset The offset in the file to start mapping at. Must be a multiple of the
+      ///   page size.
+      /// @param length The number of bytes to be mapped, or the rest of the file if not given.
+      /// @param flags The mapping mode and the access pattern hints.
+      /// @return The newly created buffer.
+      static IOBuffer map_file(IO io, size_t offset = 0,
+          std::optional<size_t> length = std::nullopt, MapFlags flags = MapFlags::ReadOnly);
+
       /// Creates an `IO::Buffer` with externally managed storage. The returned `IO::Buffer` should
       /// be `free`d when the underlying storage is longer valid.
       ///
@@ -1114,6 +1488,7 @@ namespace rcx {
       // Lockable
       /// Tries to lock the `IO::Buffer`.
       ///
+      /// This does not raise and rescue an exception when the buffer is already locked.
       /// @return Whether the lock is successful.
       bool try_lock() const;
     };
@@ -1253,6 +1628,13 @@ namespace rcx {
     ///
     inline value::ClassT<value::Exception> const IOError =
         detail::unsafe_coerce<value::ClassT<value::Exception>>(::rb_eIOError);
+#ifdef RUBY_IO_TIMEOUT_DEFAULT
+    /// `IO::TimeoutError` class
+    ///
+    /// Available on Ruby 3.2 or later.
+    inline value::ClassT<value::Exception> const IOTimeoutError =
+        detail::unsafe_coerce<value::ClassT<value::Exception>>(::rb_eIOTimeoutError);
+#endif
     /// `RuntimeError` class
     ///
     inline value::ClassT<value::Exception> const RuntimeError =
@@ -1428,6 +1810,12 @@ namespace rcx {
     struct OneWayAssociation {};
     struct TwoWayAssociation: public AssociatedValue {};
 
+    /// Marks a wrapped type whose frozen instances can be shared between Ractors.
+    ///
+    /// Derive from this in addition to `WrappedStruct` only if concurrent access through
+    /// `T const &` is thread-safe, as methods called from different Ractors may run in parallel.
+    struct FrozenShareable {};
+
     template <std::derived_from<TwoWayAssociation> T>
     void dmark(gc::Gc gc, T *RCX_Nonnull p) noexcept;
 
@@ -1516,6 +1904,363 @@ namespace rcx {
   };
   template <std::derived_from<ValueBase> T> Leak(T) -> Leak<T>;
 
+  /// A C++ range to be converted into a Ruby `Enumerator`.
+  ///
+  /// The elements are produced on demand while the `Enumerator` is iterated, so that
+  /// methods like `Enumerator#first` and `Enumerator::Lazy` stop early without producing the rest
+  /// of the elements. The `Enumerator` has a size when the range is a `std::ranges::sized_range`.
+  ///
+  /// A range that is not a `std::ranges::forward_range`, such as a coroutine-based generator,
+  /// can be iterated only once. Iterating it again raises a `RuntimeError`.
+  ///
+  /// The range is moved into the `Enumerator` and outlives the call that created it. It must own
+  /// its elements or refer only to data that lives as long as the `Enumerator`; a view of a local
+  /// container, such as `std::views::all(vec)` or a `std::string_view`, dangles once the function
+  /// returns. Move the container into the view with `std::views::all(std::move(vec))` instead.
+  ///
+  /// Ruby values stored in a container that the range owns, either directly or through
+  /// `std::views::all`, such as a `std::vector<String>`, are marked for GC. Values stored by any
+  /// other range, e.g. in the base of a `std::views::transform`, are not marked and must be kept
+  /// alive by other means.
+  ///
+  /// @tparam R The type of the range. Its elements must be convertible into Ruby values.
+  template <std::ranges::input_range R>
+    requires concepts::ConvertibleIntoValue<std::remove_cvref_t<std::ranges::range_reference_t<R>>>
+  struct Enumerate {
+    /// The range to be enumerated.
+    R range;
+  };
+  template <std::ranges::input_range R> Enumerate(R) -> Enumerate<R>;
+
+  namespace convert {
+    template <typename R> struct IntoValue<Enumerate<R>> {
+      Value convert(Enumerate<R> &value);
+    };
+  }
+
+  /// Maps a C++ exception type to a Ruby exception class.
+  ///
+  /// When a C++ exception whose dynamic type is exactly `E` escapes from a method defined with
+  /// RCX, an instance of `cls` is raised instead of a `RuntimeError`. The message is taken from
+  /// `what()` if `E` is derived from `std::exception`. Exceptions of unmapped types, including
+  /// the types derived from `E`, are converted as before.
+  ///
+  /// @warning The class will be never garbage-collected.
+  ///
+  /// @tparam E The C++ exception type.
+  /// @param cls The Ruby exception class to be raised.
+  template <typename E> void map_exception(ClassT<Exception> cls);
+
+#ifdef RCX_METHOD_STATS
+  /// Takes a snapshot of the call statistics of the methods defined with RCX.
+  ///
+  /// Available only when `RCX_METHOD_STATS` is defined, e.g. by `setup_rcx(method_stats: true)`.
+  /// Returns a `Hash` from the method names such as `"Foo#bar"` and `"Foo.baz"` to `Hash`es with
+  /// the following keys:
+  ///
+  /// - `:calls`: the number of calls, including the ones that raised.
+  /// - `:time`: the total wall-clock time spent in the method in seconds, including the time
+  ///   spent in the blocks and the other methods it called.
+  /// - `:histogram`: an `Array` of the numbers of calls bucketed by their durations. The bucket
+  ///   `i` counts the calls that took less than `2**i` nanoseconds and at least `2**(i-1)`
+  ///   nanoseconds, and the last bucket also counts all the longer calls.
+  ///
+  /// The counters are collected per thread without locking, so the snapshot may miss calls that
+  /// finish concurrently. Methods defined by \ref ClassT::define_attr_reader and its friends are
+  /// not counted.
+  ///
+  /// @return The snapshot.
+  Value method_stats();
+#endif
+
+  /// The block given to the current method.
+  ///
+  /// Yields to the block without creating a `Proc` object.
+  /// @warning A `Yielder` is valid only during the method call it is given to. Convert it into
+  ///   a `Proc` with \ref to_proc to keep the block.
+  /// @sa rcx::args::yield_block
+  class Yielder {
+    Yielder() = default;
+
+    friend struct args::YieldBlock;
+
+  public:
+    /// Yields the values to the block.
+    ///
+    /// @tparam R The type the result of the block should be converted into.
+    /// @param args The values to be yielded.
+    /// @return The result of the block.
+    template <concepts::ConvertibleFromValue R = Value>
+    R yield(concepts::ConvertibleIntoValue auto &&...args) const;
+
+    /// Converts the block into a `Proc`.
+    ///
+    /// @return The `Proc` object for the block.
+    Proc to_proc() const;
+  };
+
+  /// Pinned view of the bytes of a `String`.
+  ///
+  /// A mutable string is locked with `rb_str_locktmp` while the guard is alive, so its buffer is
+  /// neither modified nor reallocated. A frozen string cannot be modified and is not locked, so
+  /// any number of guards, also in other threads, can pin it at once. The guard itself keeps the
+  /// string referenced from the machine stack, which prevents it from being garbage-collected or
+  /// moved by compaction. This makes the bytes safe to pass to a callback of
+  /// \ref rcx::gvl::without_gvl.
+  ///
+  /// @warning The guard must be allocated on the stack.
+  class PinnedBytes {
+    String string_;
+    std::span<std::byte const> bytes_;
+    bool locked_;
+
+  public:
+    /// Pins the bytes of the string, locking it unless it is frozen.
+    ///
+    /// @param string The string to be pinned.
+    /// @throws RuntimeError When the string is mutable and already locked.
+    explicit PinnedBytes(String string);
+    PinnedBytes(PinnedBytes const &) = rcx_delete("PinnedBytes cannot be copied");
+    PinnedBytes &operator=(PinnedBytes const &) = rcx_delete("PinnedBytes cannot be copied");
+    /// Unlocks the string if it has been locked.
+    ///
+    ~PinnedBytes();
+
+    /// Returns the pinned string.
+    ///
+    /// @return The pinned string.
+    String string() const noexcept;
+    /// Returns the bytes of the pinned string.
+    ///
+    /// The returned span can be used without the GVL while the guard is alive.
+    /// @return The bytes of the pinned string.
+    std::span<std::byte const> bytes() const noexcept;
+  };
+
+#ifdef RCX_IO_BUFFER
+  /// Lock guard of an `IO::Buffer` that views its bytes.
+  ///
+  /// The buffer is locked while the guard is alive, so it is neither freed, resized nor
+  /// transferred. The bytes are looked up once when the guard is created, and the spans can be
+  /// used without the GVL, for example to hand out disjoint slices to the callbacks of
+  /// \ref rcx::gvl::without_gvl. The guard itself keeps the buffer referenced from the machine
+  /// stack.
+  ///
+  /// @warning The guard must be allocated on the stack.
+  class IOBufferGuard {
+    IOBuffer buffer_;
+    std::span<std::byte> bytes_;
+    bool writable_;
+
+    void view() noexcept;
+
+  public:
+    /// Locks the buffer.
+    ///
+    /// @param buffer The buffer to be locked.
+    /// @throws IO::Buffer::LockedError If the buffer is already locked.
+    explicit IOBufferGuard(IOBuffer buffer);
+    /// Adopts the lock of a buffer already locked by the caller.
+    ///
+    /// @param buffer The buffer locked by the caller, for example with `IOBuffer::try_lock`.
+    IOBufferGuard(IOBuffer buffer, std::adopt_lock_t) noexcept;
+    IOBufferGuard(IOBufferGuard const &) = rcx_delete("IOBufferGuard cannot be copied");
+    IOBufferGuard &operator=(IOBufferGuard const &) = rcx_delete("IOBufferGuard cannot be copied");
+    /// Unlocks the buffer.
+    ///
+    ~IOBufferGuard();
+
+    /// Returns the locked buffer.
+    ///
+    /// @return The locked buffer.
+    IOBuffer buffer() const noexcept;
+
+    /// Returns the bytes of the buffer.
+    ///
+    /// @return The bytes of the buffer.
+    /// @throws std::runtime_error If the buffer is read-only.
+    std::span<std::byte> bytes() const;
+    /// Returns a range of the bytes of the buffer.
+    ///
+    /// @param offset The offset of the range.
+    /// @param length The length of the range.
+    /// @return The bytes in the range.
+    /// @throws std::out_of_range If the range is out of the buffer.
+    /// @throws std::runtime_error If the buffer is read-only.
+    std::span<std::byte> bytes(size_t offset, size_t length) const;
+    /// Returns the bytes of the buffer as a read-only span.
+    ///
+    /// @return The bytes of the buffer.
+    std::span<std::byte const> cbytes() const noexcept;
+    /// Returns a range of the bytes of the buffer as a read-only span.
+    ///
+    /// @param offset The offset of the range.
+    /// @param length The length of the range.
+    /// @return The bytes in the range.
+    /// @throws std::out_of_range If the range is out of the buffer.
+    std::span<std::byte const> cbytes(size_t offset, size_t length) const;
+  };
+#endif
+
+#ifdef RCX_IO_BUFFER
+  /// Pool of reusable `IO::Buffer`s.
+  ///
+  /// Buffers are grouped into size classes of powers of two between the minimum and the maximum
+  /// size. Returned buffers are kept idle in the pool and handed out again, so the storage is
+  /// not reallocated. Buffers idle longer than the idle timeout are freed by \ref trim, which is
+  /// also run by \ref acquire and the release of leases once per timeout. Requests larger than
+  /// the maximum size are not pooled.
+  ///
+  /// The pool relies on the GVL for thread safety, so it can be shared by Ruby threads but not
+  /// by Ractors.
+  ///
+  /// @note The storage is reused, but each return allocates a new `IO::Buffer` object to take it
+  /// over with `IO::Buffer#transfer`, so the pool is not free of allocations in the steady
+  /// state.
+  class IOBufferPool {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// A buffer borrowed from the pool.
+    ///
+    /// The buffer is returned to the pool when the lease is destroyed or released. On return,
+    /// the ownership of the storage is transferred away from the `IO::Buffer` object (see
+    /// `IO::Buffer#transfer`), so any remaining reference to it from Ruby is invalidated.
+    /// A buffer that is still locked, or whose lease is destroyed during GC, is not returned and
+    /// is left to the GC instead.
+    ///
+    /// @warning The lease must be allocated on the stack.
+    class Lease {
+      IOBufferPool *RCX_Nullable pool_;
+      std::optional<IOBuffer> buffer_;
+
+      Lease(IOBufferPool &pool, IOBuffer buffer) noexcept;
+      friend class IOBufferPool;
+
+    public:
+      Lease(Lease &&other) noexcept;
+      Lease &operator=(Lease &&other) noexcept;
+      Lease(Lease const &) = rcx_delete("Lease cannot be copied");
+      Lease &operator=(Lease const &) = rcx_delete("Lease cannot be copied");
+      /// Returns the buffer to the pool.
+      ///
+      ~Lease();
+
+      /// Returns the borrowed buffer.
+      ///
+      /// The buffer can be larger than the requested size, and is not cleared.
+      /// @return The buffer.
+      /// @throws std::runtime_error If the lease has been released.
+      IOBuffer buffer() const;
+
+      /// Returns the buffer to the pool before the lease is destroyed.
+      ///
+      void release() noexcept;
+    };
+
+  private:
+    struct SizeClass {
+      size_t size;
+      std::vector<Clock::time_point> released;
+    };
+
+    std::vector<SizeClass> classes_;
+    /// An `Array` of the `Array`s of idle buffers for each size class.
+    VALUE idle_;
+    Clock::duration idle_timeout_;
+    Clock::time_point last_trim_;
+
+    void give_back(IOBuffer buffer) noexcept;
+    void trim_if_due();
+
+  public:
+    /// Creates a pool.
+    ///
+    /// @param min_size The size of the smallest size class, rounded up to a power of two.
+    /// @param max_size The size of the largest size class.
+    /// @param idle_timeout The time after which idle buffers are freed.
+    explicit IOBufferPool(size_t min_size = 4096, size_t max_size = size_t{1} << 24,
+        Clock::duration idle_timeout = std::chrono::seconds(10));
+    IOBufferPool(IOBufferPool const &) = rcx_delete("IOBufferPool cannot be copied");
+    IOBufferPool &operator=(IOBufferPool const &) = rcx_delete("IOBufferPool cannot be copied");
+    /// Frees the idle buffers.
+    ///
+    /// A pool with static storage duration is destroyed after the VM is gone. Its destructor
+    /// then does nothing, and the storage is released with the process.
+    ///
+    /// @warning The pool must be destroyed with the GVL held, or after the VM is gone.
+    ~IOBufferPool();
+
+    /// Borrows a buffer of at least the given size.
+    ///
+    /// Buffers of 64 KiB or larger are created with mapped storage, and smaller ones with
+    /// internal storage.
+    ///
+    /// @param size The minimum size of the buffer.
+    /// @return The lease of the buffer.
+    Lease acquire(size_t size);
+
+    /// Frees the buffers idle longer than the idle timeout.
+    ///
+    void trim();
+
+    /// Returns the total size of the idle buffers.
+    ///
+    /// @return The size in bytes.
+    size_t idle_bytes() const noexcept;
+  };
+#endif
+
+  /// A C++ exception that is raised as a Ruby exception when it escapes to Ruby.
+  ///
+  /// The message is formatted when it is first read, and the Ruby exception is created only
+  /// when it is raised. Catch this type to handle the exceptions created by
+  /// \ref rcx::value::Exception::deferred.
+  class DeferredException: public std::exception {
+    mutable std::optional<std::string> message_;
+
+  protected:
+    virtual std::string format_message() const = 0;
+
+  public:
+    /// The Ruby exception class to be raised.
+    ///
+    /// @return The exception class.
+    virtual ClassT<Exception> exception_class() const noexcept = 0;
+
+    /// Formats the message if not yet formatted.
+    ///
+    /// @return The message.
+    std::string const &message() const;
+
+    /// Returns the message, or an empty string if it cannot be formatted.
+    ///
+    /// @return The message.
+    char const *RCX_Nonnull what() const noexcept override;
+
+    /// Creates the Ruby exception to be raised.
+    ///
+    /// @return The new exception instance.
+    Exception new_exception() const;
+  };
+
+  namespace detail {
+    template <typename... Args> class DeferredFormat final: public DeferredException {
+      ClassT<Exception> cls_;
+      std::string_view fmt_;
+      std::tuple<Args...> args_;
+
+    protected:
+      std::string format_message() const override;
+
+    public:
+      template <typename... A>
+      DeferredFormat(ClassT<Exception> cls, std::string_view fmt, A &&...args);
+
+      ClassT<Exception> exception_class() const noexcept override;
+    };
+  }
+
   /// Provides access to Ruby's environment.
   ///
   class Ruby {
@@ -1561,6 +2306,22 @@ namespace rcx {
     /// @return The newly defined class.
     template <typename T = Value> ClassT<T> define_class(concepts::Identifier auto &&name);
 
+    /// Sets whether methods defined from now on are Ractor-safe.
+    ///
+    /// Methods defined while this is enabled can be called from non-main Ractors. Enabling it
+    /// also declares the extension itself as Ractor-safe. This must be called during the
+    /// extension's initialization; Ruby resets it when the `Init_` function returns.
+    ///
+    /// @note The caches behind the `_id`, `_fstr` and `_sym` literals, Symbol enums, `Symbol`
+    /// construction and `map_exception` can be filled from any Ractor. Converting an
+    /// `rcx::Enumerate` of a range type for the first time defines a class behind a
+    /// function-local static and may deadlock if it races with another Ractor; convert each range
+    /// type once in the main Ractor first. Classes must be defined and bound to their C++ types in
+    /// the main Ractor. State shared by the methods themselves, such as `Leak` values, must be
+    /// made safe by the caller.
+    /// @param safe Whether methods defined from now on are Ractor-safe.
+    void set_ractor_safe(bool safe);
+
     /// Gets the Ruby environment without GVL checking.
     ///
     /// @warning This method bypasses GVL checking and should only be used
@@ -1605,6 +2366,18 @@ namespace rcx {
       return static_cast<ReleaseFlags>(static_cast<int>(lhs) & static_cast<int>(rhs));
     }
 
+    /// Unblock function that interrupts a blocking system call by a signal.
+    ///
+    /// Pass \ref ubf_io to \ref without_gvl to make the callback interruptible in the same way
+    /// as Ruby's own IO methods. The interrupted system call fails with `EINTR`.
+    struct UbfIo {
+      void operator()() const noexcept {
+      }
+    };
+
+    /// Unblock function that interrupts a blocking system call by a signal.
+    inline constexpr UbfIo ubf_io{};
+
     /// Releases the GVL and executes a function.
     ///
     /// This function releases the Global VM Lock (GVL) before executing the
@@ -1619,15 +2392,18 @@ namespace rcx {
     /// @param ubf An optional unblock function to interrupt the callback
     ///   execution. This function can be called from another thread.
     /// @param flags Control flags for the GVL release behavior.
+    /// @param location The call site, which the statistics are aggregated by.
+    ///   The parameter is present only when `RCX_GVL_STATS` is defined.
     /// @return When the callback returns `void`, this function returns `true` if the callback
     ///   was executed completely, or `false` if it was interrupted by `ubf`.
     ///   When the callback returns a value, this function returns an `std::optional` containing
     ///   the result if the callback was executed completely, or `std::nullopt`
     ///   if it was interrupted.
     template <std::invocable<> F, std::invocable U>
-    auto without_gvl(F callback, std::optional<U> ubf, ReleaseFlags flags) noexcept(noexcept(
-        callback(), (*ubf)())) -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
-        std::optional<std::invoke_result_t<F>>>;
+    auto without_gvl(F callback, std::optional<U> ubf, ReleaseFlags flags RCX_LOCATION_PARAM)
+        noexcept(noexcept(callback(), (*ubf)()))
+            -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
+                std::optional<std::invoke_result_t<F>>>;
 
     /// Releases the GVL and executes a function.
     ///
@@ -1640,19 +2416,170 @@ namespace rcx {
     /// @tparam F The type of the callback function.
     /// @param callback The function to execute without the GVL.
     /// @param flags Control flags for the GVL release behavior.
+    /// @param location The call site, which the statistics are aggregated by.
+    ///   The parameter is present only when `RCX_GVL_STATS` is defined.
     /// @return When the callback returns `void`, this function returns `true` if the callback
     ///   was executed completely, or `false` if it was interrupted.
     ///   When the callback returns a value, this function returns an `std::optional` containing
     ///   the result if the callback was executed completely, or `std::nullopt`
     ///   if it was interrupted.
     template <std::invocable<> F>
-    auto without_gvl(F &&callback, ReleaseFlags flags) noexcept(noexcept(callback()))
-        -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
-            std::optional<std::invoke_result_t<F>>>;
+    auto without_gvl(F &&callback, ReleaseFlags flags RCX_LOCATION_PARAM)
+        noexcept(noexcept(callback()))
+            -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
+                std::optional<std::invoke_result_t<F>>>;
+
+#ifdef RCX_GVL_STATS
+    /// Takes a snapshot of the statistics of the GVL releases.
+    ///
+    /// Available only when `RCX_GVL_STATS` is defined, e.g. by `setup_rcx(gvl_stats: true)`.
+    /// Returns a `Hash` with the following keys:
+    ///
+    /// - `:sites`: a `Hash` from the call sites of \ref without_gvl, such as `"foo.cpp:42"`, to
+    ///   `Hash`es with the following keys:
+    ///   - `:calls`: the number of calls.
+    ///   - `:cancelled`: the number of calls whose callback was not executed.
+    ///   - `:ubf_calls`: the number of times the unblock function was called.
+    ///   - `:released_time`: the total time in seconds the callback ran without the GVL.
+    ///   - `:reacquire_time`: the total time in seconds spent to reacquire the GVL after the
+    ///     callback finished.
+    /// - `:waits`: the number of times any Ruby thread waited for the GVL.
+    /// - `:wait_time`: the total time in seconds Ruby threads waited for the GVL.
+    ///
+    /// `:waits` and `:wait_time` are available only on Ruby 3.2 or later, and count the waits
+    /// since the first call to this function or \ref without_gvl.
+    ///
+    /// @return The snapshot.
+    Value stats();
+#endif
 
     /// Checks for pending interrupts.
     void check_interrupts();
   }
+
+#if defined(RCX_URING) && defined(RCX_IO_BUFFER)
+  /// Batched IO with io_uring.
+  ///
+  /// Available only when liburing is found by `setup_rcx`.
+  namespace uring {
+    /// A request to read from a file at a position into an `IO::Buffer`.
+    struct ReadRequest {
+      /// The file to read from.
+      IO io;
+      /// The buffer to read into.
+      IOBuffer buffer;
+      /// The position in the file to read from.
+      size_t offset;
+    };
+
+    /// The result of a \ref ReadRequest.
+    struct ReadResult {
+      /// The number of bytes read. It can be less than the size of the buffer.
+      size_t bytes = 0;
+      /// The `errno` value if the read failed, or zero.
+      int error = 0;
+    };
+
+    /// An io_uring instance.
+    ///
+    /// A ring must not be used by more than one thread at the same time.
+    class Ring {
+      ::io_uring ring_;
+      unsigned entries_;
+      bool poisoned_ = false;
+
+      void reap(size_t &pending) noexcept;
+      int wait(size_t &pending) noexcept;
+      int cancel(std::span<ReadResult> results, size_t &pending) noexcept;
+
+    public:
+      /// Creates an io_uring instance.
+      ///
+      /// @param entries The size of the submission queue.
+      /// @throws SystemCallError If io_uring is not available.
+      explicit Ring(unsigned entries = 256);
+      Ring(Ring const &) = rcx_delete("Ring cannot be copied");
+      Ring &operator=(Ring const &) = rcx_delete("Ring cannot be copied");
+      ~Ring();
+
+      /// Reads into the buffers.
+      ///
+      /// The buffers are locked, and the reads are submitted in batches of the size of the
+      /// submission queue. The GVL is released while submitting and waiting for completion, and
+      /// the wait can be interrupted by other threads, e.g. with `Thread#kill`. The reads in
+      /// flight are cancelled and waited for before an exception is propagated.
+      ///
+      /// If the reads in flight cannot be waited for, the buffers stay locked and are never
+      /// freed, since the kernel may still write into them, and the ring refuses further reads.
+      ///
+      /// @param requests The read requests.
+      /// @param location The call site, which the GVL statistics are aggregated by.
+      ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+      /// @return The results in the order of the requests.
+      /// @throws IOError If an IO is not readable, or the ring is unusable after a failure.
+      /// @throws SystemCallError If io_uring fails.
+      std::vector<ReadResult> read(std::span<ReadRequest const> requests RCX_LOCATION_PARAM);
+    };
+
+    /// Reads into the buffers with the ring of the current thread.
+    ///
+    /// @param requests The read requests.
+    /// @param location The call site, which the GVL statistics are aggregated by.
+    ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+    /// @return The results in the order of the requests.
+    /// @throws SystemCallError If io_uring fails.
+    std::vector<ReadResult> read(std::span<ReadRequest const> requests RCX_LOCATION_PARAM);
+
+    /// Reads into the buffers with the ring of the current thread.
+    ///
+    /// @param requests An `Array` of `[io, buffer, offset]` Arrays.
+    /// @param location The call site, which the GVL statistics are aggregated by.
+    ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+    /// @return An `Array` of the number of bytes read, or `SystemCallError` for failed reads,
+    ///   in the order of the requests.
+    /// @throws SystemCallError If io_uring fails.
+    Array read(Array requests RCX_LOCATION_PARAM);
+  }
+#endif
+
+  /// Scanning bytes for delimiters.
+  ///
+  /// The scan uses the widest SIMD instructions available at run time: AVX2 or SSE2 on x86-64,
+  /// and NEON on AArch64. Other platforms use `memchr`.
+  namespace scan {
+    /// Finds the offsets of all occurrences of a delimiter.
+    ///
+    /// This does not call Ruby, so it can be called without the GVL, for example over the
+    /// bytes of a \ref rcx::PinnedBytes or an \ref rcx::IOBufferGuard.
+    ///
+    /// @param bytes The bytes to scan.
+    /// @param delimiter The delimiter to find.
+    /// @param offsets The vector to append the offsets to.
+    void find_all(std::span<std::byte const> bytes, std::byte delimiter,
+        std::vector<size_t> &offsets);
+
+    /// Finds the offsets of all occurrences of a delimiter.
+    ///
+    /// @param bytes The bytes to scan.
+    /// @param delimiter The delimiter to find.
+    /// @return The offsets in ascending order.
+    std::vector<size_t> find_all(std::span<std::byte const> bytes, std::byte delimiter);
+
+    /// Splits a String by a delimiter into frozen substrings.
+    ///
+    /// The String is scanned without the GVL if it is large. The substrings are created by
+    /// \ref String::subseq, so only the last one can share the buffer of the String, when
+    /// it extends to the end and is too long to be embedded. The delimiters are not included,
+    /// and the empty substring after the last delimiter is omitted, so `"a\nb\n"` is split into
+    /// `["a", "b"]`.
+    ///
+    /// @param string The String to split.
+    /// @param delimiter The delimiter.
+    /// @param location The call site, which the GVL statistics are aggregated by.
+    ///   The parameter is present only when `RCX_GVL_STATS` is defined.
+    /// @return The Array of the substrings.
+    Array split(String string, char delimiter = '\n' RCX_LOCATION_PARAM);
+  }
 }
 
 namespace std {
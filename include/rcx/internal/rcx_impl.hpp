@@ -1,26 +1,69 @@
 // SPDX-License-Identifier: BSL-1.0
 // SPDX-FileCopyrightText: Copyright 2024-2025 Kasumi Hanazuki <kasumi@rollingapple.net>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <concepts>
+#include <cstring>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
 #include <ranges>
+#include <shared_mutex>
+#include <source_location>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include <ffi.h>
 #include <rcx/internal/rcx.hpp>
-#include <ruby/io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#if HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #if HAVE_CXXABI_H
 #include <cxxabi.h>
 #endif
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RCX_SCAN_X86_64
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define RCX_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef RCX_USDT
+#include <sys/sdt.h>
+#define RCX_PROBE(name, ...) STAP_PROBEV(rcx, name __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define RCX_PROBE(name, ...) ((void)0)
+#endif
+
 namespace std {
   template <std::derived_from<rcx::Value> T>
   template <typename ParseContext>
@@ -63,6 +106,183 @@ namespace rcx {
     auto cxx_protect(std::invocable<> auto const &functor) noexcept
         -> std::invoke_result_t<decltype(functor)>;
 
+#ifdef RCX_METHOD_STATS
+    /**
+     * Call statistics of the methods defined with RCX.
+     *
+     * Each thread counts the calls into its own counters so that the hot path needs neither
+     * locks nor atomic read-modify-write operations. The registry is locked only when a method
+     * is defined, when a thread starts or finishes counting, and when a snapshot is taken.
+     */
+    class MethodStats {
+    public:
+      static constexpr std::size_t histogram_buckets = 32;
+
+      struct Totals {
+        std::uint64_t calls = 0;
+        std::uint64_t nanoseconds = 0;
+        std::array<std::uint64_t, histogram_buckets> histogram{};
+      };
+
+    private:
+      struct Counters {
+        std::atomic<std::uint64_t> calls;
+        std::atomic<std::uint64_t> nanoseconds;
+        std::array<std::atomic<std::uint64_t>, histogram_buckets> histogram;
+      };
+
+      class ThreadCounters {
+        static constexpr std::size_t chunk_size = 64;
+        static constexpr std::size_t max_chunks = 256;
+
+        std::array<std::atomic<Counters *>, max_chunks> chunks_{};
+
+        // Only the owner thread writes to the counters.
+        static void bump(std::atomic<std::uint64_t> &counter, std::uint64_t n) noexcept {
+          counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+      public:
+        static constexpr std::size_t max_methods = chunk_size * max_chunks;
+
+        ThreadCounters() {
+          instance().attach(this);
+        }
+        ThreadCounters(ThreadCounters const &) = delete;
+        ~ThreadCounters() {
+          instance().detach(this);
+          for(auto &chunk: chunks_) {
+            delete[] chunk.load(std::memory_order_relaxed);
+          }
+        }
+        ThreadCounters &operator=(ThreadCounters const &) = delete;
+
+        void add(std::size_t index, std::uint64_t nanoseconds) noexcept {
+          auto &slot = chunks_[index / chunk_size];
+          auto chunk = slot.load(std::memory_order_relaxed);
+          if(!chunk) {
+            chunk = new(std::nothrow) Counters[chunk_size]{};
+            if(!chunk) {
+              return;  // drop the sample
+            }
+            slot.store(chunk, std::memory_order_release);
+          }
+          auto &counters = chunk[index % chunk_size];
+          bump(counters.calls, 1);
+          bump(counters.nanoseconds, nanoseconds);
+          bump(counters.histogram[std::min<std::size_t>(
+                   std::bit_width(nanoseconds), histogram_buckets - 1)],
+              1);
+        }
+
+        void sum_into(std::vector<Totals> &totals) const noexcept {
+          for(std::size_t i = 0; i < totals.size(); ++i) {
+            auto const chunk = chunks_[i / chunk_size].load(std::memory_order_acquire);
+            if(!chunk) {
+              i += chunk_size - 1 - i % chunk_size;
+              continue;
+            }
+            auto const &counters = chunk[i % chunk_size];
+            totals[i].calls += counters.calls.load(std::memory_order_relaxed);
+            totals[i].nanoseconds += counters.nanoseconds.load(std::memory_order_relaxed);
+            for(std::size_t b = 0; b < histogram_buckets; ++b) {
+              totals[i].histogram[b] += counters.histogram[b].load(std::memory_order_relaxed);
+            }
+          }
+        }
+      };
+
+      std::mutex mutex_;
+      std::vector<std::string> names_;
+      std::unordered_map<void const *, std::size_t> callbacks_;
+      std::vector<ThreadCounters const *> threads_;
+      std::vector<Totals> retired_;
+
+      void attach(ThreadCounters const *counters) {
+        std::lock_guard const lock(mutex_);
+        threads_.push_back(counters);
+      }
+
+      void detach(ThreadCounters const *counters) noexcept {
+        std::lock_guard const lock(mutex_);
+        std::erase(threads_, counters);
+        counters->sum_into(retired_);
+      }
+
+    public:
+      /// Measures the duration of a call to the method.
+      class Timer {
+        std::size_t index_;
+        std::chrono::steady_clock::time_point start_;
+
+      public:
+        explicit Timer(std::size_t index) noexcept
+            : index_(index), start_(std::chrono::steady_clock::now()) {
+        }
+        Timer(Timer const &) = delete;
+        ~Timer() noexcept {
+          auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start_);
+          try {
+            thread_local ThreadCounters counters;
+            counters.add(index_, static_cast<std::uint64_t>(elapsed.count()));
+          } catch(...) {
+            // Registering the counters of this thread failed; drop the sample and retry next time.
+          }
+        }
+        Timer &operator=(Timer const &) = delete;
+      };
+
+      /// Allocates the counters for a method implemented by the callback.
+      std::size_t add(void const *RCX_Nonnull callback) {
+        std::lock_guard const lock(mutex_);
+        if(names_.size() >= ThreadCounters::max_methods) {
+          throw std::runtime_error("Too many methods to collect the statistics of");
+        }
+        callbacks_.emplace(callback, names_.size());
+        names_.emplace_back();
+        // Grown here so that detaching a thread never allocates.
+        retired_.resize(names_.size());
+        return names_.size() - 1;
+      }
+
+      /// Names the method implemented by the callback.
+      void name(void const *RCX_Nonnull callback, Value module, ID mid);
+
+      /// Sums up the counters of all the threads by the method names.
+      std::vector<std::pair<std::string, Totals>> snapshot() {
+        std::lock_guard const lock(mutex_);
+        std::vector<Totals> totals = retired_;
+        totals.resize(names_.size());
+        for(auto const counters: threads_) {
+          counters->sum_into(totals);
+        }
+
+        std::vector<std::pair<std::string, Totals>> result;
+        for(std::size_t i = 0; i < names_.size(); ++i) {
+          if(names_[i].empty()) {
+            continue;
+          }
+          auto const it =
+              std::ranges::find(result, names_[i], &std::pair<std::string, Totals>::first);
+          auto &sum =
+              it != result.end() ? it->second : result.emplace_back(names_[i], Totals{}).second;
+          sum.calls += totals[i].calls;
+          sum.nanoseconds += totals[i].nanoseconds;
+          for(std::size_t b = 0; b < histogram_buckets; ++b) {
+            sum.histogram[b] += totals[i].histogram[b];
+          }
+        }
+        return result;
+      }
+
+      static MethodStats &instance() {
+        static auto const stats = new MethodStats;  // let it leak
+        return *stats;
+      }
+    };
+#endif
+
     inline NativeRbFunc *RCX_Nonnull alloc_callback(std::function<RbFunc> f) {
       static std::array argtypes = {
         &ffi_type_sint,     // int argc
@@ -84,9 +304,22 @@ namespace rcx {
         auto argv = *reinterpret_cast<Value **>(args[1]);
         auto self = *reinterpret_cast<Value *>(args[2]);
         // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        RCX_PROBE(method__entry, argc, argv, self.as_VALUE());
         *reinterpret_cast<Value *>(ret) = cxx_protect([&] {
+#ifdef RCX_USDT
+          try {
+            return (*reinterpret_cast<decltype(f) *>(function))(
+                std::span<Value>(argv, argc), self);
+          } catch(...) {
+            // method__return is skipped when the method raises.
+            RCX_PROBE(method__raise, self.as_VALUE());
+            throw;
+          }
+#else
           return (*reinterpret_cast<decltype(f) *>(function))(std::span<Value>(argv, argc), self);
+#endif
         });
+        RCX_PROBE(method__return, reinterpret_cast<Value *>(ret)->as_VALUE());
       };
 
       void *callback = nullptr;
@@ -96,6 +329,14 @@ namespace rcx {
         throw std::runtime_error{"ffi_closure_alloc failed"};
       }
 
+#ifdef RCX_METHOD_STATS
+      f = [inner = std::move(f), index = MethodStats::instance().add(callback)](
+              std::span<Value> args, Value self) {
+        MethodStats::Timer const timer(index);
+        return inner(args, self);
+      };
+#endif
+
       if(ffi_prep_closure_loc(closure, &cif, trampoline,
              new decltype(f)(std::move(f)),  // let it leak
              callback) != FFI_OK) {
@@ -211,6 +452,97 @@ namespace rcx {
       return reinterpret_cast<R (*RCX_Nonnull)(A..., ...) noexcept>(f);
     }
 
+#ifdef RCX_METHOD_STATS
+    inline void MethodStats::name(void const *RCX_Nonnull callback, Value module, ID mid) {
+      String const method = unsafe_coerce<String>(protect(assume_noexcept(::rb_id2str), mid));
+      std::string label;
+      if(RB_FL_TEST(module.as_VALUE(), RUBY_FL_SINGLETON)) {
+        Value const owner = unsafe_coerce<Value>(
+            protect(assume_noexcept(::rb_class_attached_object), module.as_VALUE()));
+        label = std::format("{}.{}", owner, method);
+      } else {
+        label = std::format("{}#{}", module, method);
+      }
+
+      std::lock_guard const lock(mutex_);
+      if(auto const it = callbacks_.find(callback); it != callbacks_.end()) {
+        names_[it->second] = std::move(label);
+      }
+    }
+#endif
+
+    inline void define_method(VALUE module, ID mid, NativeRbFunc *RCX_Nonnull callback) {
+      protect([&]() noexcept { rb_define_method_id(module, mid, callback, -1); });
+#ifdef RCX_METHOD_STATS
+      MethodStats::instance().name(
+          reinterpret_cast<void const *>(callback), unsafe_coerce<Value>(module), mid);
+#endif
+    }
+
+    /**
+     * Process-wide cache of static IDs keyed by their names.
+     *
+     * Each name is resolved through Ruby at most once. IDs registered here are static and
+     * never garbage-collected, so the cache never has to be invalidated.
+     */
+    class IdCache {
+      struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const noexcept {
+          return std::hash<std::string_view>{}(name);
+        }
+      };
+
+      std::shared_mutex mutex_;
+      std::unordered_map<std::string, ID, Hash, std::equal_to<>> ids_;
+
+    public:
+      ID intern(std::string_view name) {
+        {
+          std::shared_lock const lock(mutex_);
+          if(auto const it = ids_.find(name); it != ids_.end()) {
+            return it->second;
+          }
+        }
+        auto const id = protect(
+            [&]() noexcept { return assume_noexcept(::rb_intern2)(name.data(), name.size()); });
+        std::unique_lock const lock(mutex_);
+        return ids_.try_emplace(std::string(name), id).first->second;
+      }
+
+      static IdCache &instance() {
+        static IdCache cache;
+        return cache;
+      }
+    };
+
+    /**
+     * Returns the value in the slot, computing and publishing it on the first use.
+     *
+     * Unlike a function-local static with a dynamic initializer, no guard is held while the
+     * value is computed. A thread that calls into Ruby inside such an initializer may wait for
+     * a GC barrier while a thread of another Ractor is blocked on the guard outside of Ruby,
+     * and neither can proceed. Here racing threads compute the value each and the first one to
+     * publish it wins, so the computation must be idempotent.
+     */
+    template <typename T, std::invocable<> F>
+    inline T publish_once(std::atomic<T> &slot, F &&compute) {
+      if(auto const value = slot.load(std::memory_order_acquire)) {
+        return value;
+      }
+      T const value = std::forward<F>(compute)();
+      T expected{};
+      return slot.compare_exchange_strong(expected, value, std::memory_order_acq_rel) ? value
+                                                                                     : expected;
+    }
+
+    // Keeps an interned String alive for the lifetime of the process.
+    inline VALUE leak_fstring(String str) {
+      auto const value = str.as_VALUE();
+      protect([value]() noexcept { ::rb_gc_register_mark_object(value); });
+      return value;
+    }
+
     /**
      * Converts anything into ID.
      *
@@ -221,11 +553,33 @@ namespace rcx {
                      { id.as_ID() } noexcept -> std::same_as<ID>;
                    }) {
         return id.as_ID();
+      } else if constexpr(std::is_convertible_v<I, std::string_view>) {
+        return IdCache::instance().intern(std::forward<decltype(id)>(id));
       } else {
         return Symbol(std::forward<decltype(id)>(id)).as_ID();
       }
     }
 
+    // Native method functions for attributes. These do not need ffi closures, since the member
+    // is known at compile time.
+    template <typename T, auto Member> struct attr_callback {
+      static VALUE reader(VALUE self) {
+        return cxx_protect([self] {
+          T const &obj = from_Value<T const>(detail::unsafe_coerce<Value>(self));
+          return into_Value(obj.*Member).as_VALUE();
+        });
+      }
+
+      static VALUE writer(VALUE self, VALUE value) {
+        return cxx_protect([self, value] {
+          using M = std::remove_cvref_t<decltype(std::declval<T &>().*Member)>;
+          T &obj = from_Value<T>(detail::unsafe_coerce<Value>(self));
+          obj.*Member = from_Value<M>(detail::unsafe_coerce<Value>(value));
+          return value;
+        });
+      }
+    };
+
     // Calculate the default type of the self parameter for the methods of ClassT<T>.
     template <concepts::ConvertibleFromValue T>
     using self_type =
@@ -281,6 +635,21 @@ namespace rcx {
       }
       return block.parse(ruby, self, args);
     }
+
+    inline YieldBlock::ResultType YieldBlock::parse(Ruby &, Value, std::span<Value> &) {
+      if(!::rb_block_given_p()) {
+        throw Exception::format(builtin::LocalJumpError, "no block given (yield)");
+      }
+      return Yielder();
+    }
+
+    inline YieldBlockOpt::ResultType YieldBlockOpt::parse(
+        Ruby &ruby, Value self, std::span<Value> &args) {
+      if(!::rb_block_given_p()) {
+        return std::nullopt;
+      }
+      return yield_block.parse(ruby, self, args);
+    }
   }
 
   namespace convert {
@@ -375,6 +744,17 @@ namespace rcx {
 
     template <std::derived_from<typed_data::WrappedStructBase> T>
     inline std::reference_wrapper<T> FromValue<T>::convert(Value value) {
+      // Fast path for the objects exactly of the bound type, which does not call into Ruby.
+      if(auto const v = value.as_VALUE();
+          RB_TYPE_P(v, RUBY_T_DATA) && RTYPEDDATA_P(v) &&
+          RTYPEDDATA_TYPE(v) == typed_data::DataType<T>::get() &&
+          (std::is_const_v<T> || !RB_OBJ_FROZEN_RAW(v))) {
+        if(auto const data = RTYPEDDATA_DATA(v)) {
+          return std::ref(*static_cast<T *>(data));
+        }
+      }
+
+      // Slow path for subtypes, mismatching types and errors.
       if constexpr(!std::is_const_v<T>) {
         detail::protect([&]() noexcept { ::rb_check_frozen(value.as_VALUE()); });
       }
@@ -479,7 +859,9 @@ namespace rcx {
         },
         .parent = parent,
         .data = reinterpret_cast<void *>(klass.as_VALUE()),
-        .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+        .flags = RUBY_TYPED_FREE_IMMEDIATELY |
+                 (std::derived_from<T, typed_data::FrozenShareable> ? RUBY_TYPED_FROZEN_SHAREABLE
+                                                                    : 0),
       };
       ::rb_gc_register_address(reinterpret_cast<VALUE *>(&data_type_->data));
 
@@ -613,11 +995,9 @@ namespace rcx {
         std::invocable<Self, typename ArgSpec::ResultType...> auto &&function, ArgSpec...) const {
       auto const callback = detail::method_callback<args::Self<Self>, ArgSpec...>::alloc(
           std::forward<decltype(function)>(function));
-      detail::protect([&]() noexcept {
-        auto const singleton = ::rb_singleton_class(this->as_VALUE());
-        rb_define_method_id(
-            singleton, detail::into_ID(std::forward<decltype(mid)>(mid)), callback, -1);
-      });
+      auto const singleton =
+          detail::protect(detail::assume_noexcept(::rb_singleton_class), this->as_VALUE());
+      detail::define_method(singleton, detail::into_ID(std::forward<decltype(mid)>(mid)), callback);
       return *static_cast<Derived const *>(this);
     }
 
@@ -628,11 +1008,9 @@ namespace rcx {
         std::invocable<typename ArgSpec::ResultType...> auto &&function, ArgSpec...) const {
       auto const callback =
           detail::method_callback<ArgSpec...>::alloc(std::forward<decltype(function)>(function));
-      detail::protect([&]() noexcept {
-        auto const singleton = ::rb_singleton_class(this->as_VALUE());
-        rb_define_method_id(
-            singleton, detail::into_ID(std::forward<decltype(mid)>(mid)), callback, -1);
-      });
+      auto const singleton =
+          detail::protect(detail::assume_noexcept(::rb_singleton_class), this->as_VALUE());
+      detail::define_method(singleton, detail::into_ID(std::forward<decltype(mid)>(mid)), callback);
       return *static_cast<Derived const *>(this);
     }
 
@@ -723,10 +1101,8 @@ namespace rcx {
     inline Module Module::define_method(concepts::Identifier auto &&mid,
         std::invocable<Self, typename ArgSpec::ResultType...> auto &&function, ArgSpec...) const {
       auto const callback = detail::method_callback<args::Self<Self>, ArgSpec...>::alloc(function);
-      detail::protect([&]() noexcept {
-        rb_define_method_id(
-            as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback, -1);
-      });
+      detail::define_method(
+          as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback);
       return *this;
     }
 
@@ -734,10 +1110,8 @@ namespace rcx {
     inline Module Module::define_method(concepts::Identifier auto &&mid,
         std::invocable<typename ArgSpec::ResultType...> auto &&function, ArgSpec...) const {
       auto const callback = detail::method_callback<ArgSpec...>::alloc(function);
-      detail::protect([&]() noexcept {
-        rb_define_method_id(
-            as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback, -1);
-      });
+      detail::define_method(
+          as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback);
       return *this;
     }
 
@@ -820,10 +1194,8 @@ namespace rcx {
       auto const callback =
           detail::method_callback<args::Self<detail::self_type<T>>, ArgSpec...>::alloc(
               std::forward<decltype(function)>(function));
-      detail::protect([&]() noexcept {
-        rb_define_method_id(
-            this->as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback, -1);
-      });
+      detail::define_method(
+          this->as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback);
       return *this;
     }
 
@@ -835,23 +1207,51 @@ namespace rcx {
       auto const callback =
           detail::method_callback<args::Self<detail::self_type_const<T>>, ArgSpec...>::alloc(
               function);
+      detail::define_method(
+          this->as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback);
+      return *this;
+    }
+
+    template <typename T>
+    template <auto Member>
+      requires std::is_member_object_pointer_v<decltype(Member)>
+    inline ClassT<T> ClassT<T>::define_attr_reader(concepts::Identifier auto &&name) const {
+      auto const callback = detail::attr_callback<T, Member>::reader;
       detail::protect([&]() noexcept {
         rb_define_method_id(
-            this->as_VALUE(), detail::into_ID(std::forward<decltype(mid)>(mid)), callback, -1);
+            this->as_VALUE(), detail::into_ID(std::forward<decltype(name)>(name)), callback, 0);
+      });
+      return *this;
+    }
+
+    template <typename T>
+    template <auto Member>
+      requires std::is_member_object_pointer_v<decltype(Member)>
+    inline ClassT<T> ClassT<T>::define_attr_writer(concepts::Identifier auto &&name) const {
+      auto const callback = detail::attr_callback<T, Member>::writer;
+      detail::protect([&]() noexcept {
+        rb_define_method_id(this->as_VALUE(),
+            ::rb_id_attrset(detail::into_ID(std::forward<decltype(name)>(name))), callback, 1);
       });
       return *this;
     }
 
+    template <typename T>
+    template <auto Member>
+      requires std::is_member_object_pointer_v<decltype(Member)>
+    inline ClassT<T> ClassT<T>::define_attr_accessor(concepts::Identifier auto &&name) const {
+      define_attr_reader<Member>(name);
+      return define_attr_writer<Member>(std::forward<decltype(name)>(name));
+    }
+
     template <typename T>
     template <concepts::ArgSpec... ArgSpec>
       requires std::constructible_from<T, typename ArgSpec::ResultType...>
     inline ClassT<T> ClassT<T>::define_constructor(ArgSpec...) const {
       auto const callback = detail::method_callback<args::Self<Value>, ArgSpec...>::alloc(
           typed_data::DataType<T>::template initialize<typename ArgSpec::ResultType...>);
-      detail::protect([&]() noexcept {
-        using namespace literals;
-        rb_define_method_id(this->as_VALUE(), detail::into_ID("initialize"_id), callback, -1);
-      });
+      using namespace literals;
+      detail::define_method(this->as_VALUE(), detail::into_ID("initialize"_id), callback);
       return *this;
     }
 
@@ -861,10 +1261,8 @@ namespace rcx {
     {
       auto const callback = detail::method_callback<args::Self<Value>, args::Arg<T const &>>::alloc(
           typed_data::DataType<T>::initialize_copy);
-      detail::protect([&]() noexcept {
-        using namespace literals;
-        rb_define_method_id(this->as_VALUE(), detail::into_ID("initialize_copy"_id), callback, -1);
-      });
+      using namespace literals;
+      detail::define_method(this->as_VALUE(), detail::into_ID("initialize_copy"_id), callback);
       return *this;
     }
 
@@ -894,10 +1292,7 @@ namespace rcx {
     }
 
     inline Symbol::Symbol(std::string_view sv) noexcept
-        : Symbol(detail::protect([&]() noexcept {
-            return detail::assume_noexcept(::rb_to_symbol)(
-                detail::assume_noexcept(::rb_interned_str)(sv.data(), sv.size()));
-          })) {
+        : Symbol(detail::unsafe_coerce<Symbol>(RB_ID2SYM(detail::IdCache::instance().intern(sv)))) {
     }
 
     inline ID Symbol::as_ID() const noexcept {
@@ -946,6 +1341,16 @@ namespace rcx {
       return copy_from(std::basic_string_view<CharT>(s));
     }
 
+    template <concepts::StringLike S> inline String String::new_static(S &&s) {
+      using CharT = typename std::remove_cvref_t<S>::value_type;
+      using Traits = typename std::remove_cvref_t<S>::traits_type;
+      std::basic_string_view<CharT, Traits> sv(std::forward<S>(s));
+      return detail::unsafe_coerce<String>(detail::protect([&]() noexcept {
+        return (::rb_enc_str_new_static)(
+            reinterpret_cast<char const *>(sv.data()), sv.size(), CharTraits<CharT>::encoding());
+      }));
+    }
+
     inline size_t String::size() const noexcept {
       return RSTRING_LEN(as_VALUE());
     }
@@ -960,7 +1365,7 @@ namespace rcx {
     }
 
     inline String::operator std::string_view() const noexcept {
-      return {data(), size()};
+      return {cdata(), size()};
     }
 
     inline String String::lock() const {
@@ -972,6 +1377,36 @@ namespace rcx {
       return detail::unsafe_coerce<String>(
           detail::protect(detail::assume_noexcept(::rb_str_unlocktmp), as_VALUE()));
     }
+
+    inline String String::subseq(size_t offset, size_t length) const {
+      if(offset > size() || length > size() - offset) {
+        throw Exception::format(builtin::IndexError,
+            "Range {}...{} is out of the string of size {}", offset, offset + length, size());
+      }
+      return detail::unsafe_coerce<String>(detail::protect([&]() noexcept {
+        return ::rb_str_subseq(as_VALUE(), static_cast<long>(offset), static_cast<long>(length));
+      }));
+    }
+
+    inline Array String::subseq(std::span<std::pair<size_t, size_t> const> ranges) const {
+      auto const string_size = size();
+      for(auto const &[offset, length]: ranges) {
+        if(offset > string_size || length > string_size - offset) {
+          throw Exception::format(builtin::IndexError,
+              "Range {}...{} is out of the string of size {}", offset, offset + length,
+              string_size);
+        }
+      }
+      // Create all the substrings in a single protect.
+      return detail::unsafe_coerce<Array>(detail::protect([&]() noexcept {
+        auto const array = ::rb_ary_new_capa(static_cast<long>(ranges.size()));
+        for(auto const &[offset, length]: ranges) {
+          ::rb_ary_push(array,
+              ::rb_str_subseq(as_VALUE(), static_cast<long>(offset), static_cast<long>(length)));
+        }
+        return array;
+      }));
+    }
   }
 
   inline String convert::FromValue<String>::convert(Value value) {
@@ -998,6 +1433,22 @@ namespace rcx {
       return detail::unsafe_coerce<Value>(
           detail::protect([&]() noexcept { return ::rb_proc_call(as_VALUE(), args.as_VALUE()); }));
     }
+
+    template <concepts::ConvertibleFromValue R>
+    inline R Proc::call(concepts::ConvertibleIntoValue auto &&...args) const {
+      return call_with_block<R>(
+          detail::unsafe_coerce<Proc>(RUBY_Qnil), std::forward<decltype(args)>(args)...);
+    }
+
+    template <concepts::ConvertibleFromValue R>
+    inline R Proc::call_with_block(
+        Proc block, concepts::ConvertibleIntoValue auto &&...args) const {
+      std::array<VALUE, sizeof...(args)> const argv{
+        into_Value(std::forward<decltype(args)>(args)).as_VALUE()...};
+      return from_Value<R>(detail::unsafe_coerce<Value>(detail::protect([&]() noexcept {
+        return ::rb_proc_call_with_block(as_VALUE(), argv.size(), argv.data(), block.as_VALUE());
+      })));
+    }
   }
 
   namespace convert {
@@ -1016,7 +1467,15 @@ namespace rcx {
     template <std::derived_from<Exception> E, typename... Args>
     inline E Exception::format(ClassT<E> cls, std::format_string<Args...> fmt, Args &&...args) {
       auto const msg = std::vformat(fmt.get(), std::make_format_args(args...));
-      return cls.new_instance(String::intern_from(msg));
+      return cls.new_instance(String::copy_from(msg).freeze());
+    }
+
+    template <std::derived_from<Exception> E, typename... Args>
+      requires(!std::derived_from<std::remove_cvref_t<Args>, ValueBase> && ...)
+    inline detail::DeferredFormat<detail::deferred_arg_t<Args>...> Exception::deferred(
+        ClassT<E> cls, std::format_string<Args...> fmt, Args &&...args) {
+      return {detail::unsafe_coerce<ClassT<Exception>>(cls.as_VALUE()), fmt.get(),
+        std::forward<Args>(args)...};
     }
 
     inline Exception Exception::new_from_errno(char const *RCX_Nullable message, int err) {
@@ -1056,57 +1515,368 @@ namespace rcx {
         rb_io_check_writable(pio);
       });
     }
-  }
 
-  namespace convert {
-    inline IO FromValue<IO>::convert(Value value) {
-      if(!value.is_kind_of(builtin::IO)) {
-        throw Exception::format(
-            builtin::TypeError, "Expected an IO but got a {}", value.get_class());
-      }
-      return detail::unsafe_coerce<IO>(value.as_VALUE());
+    inline IO::Events IO::wait(
+        Events events, std::optional<std::chrono::nanoseconds> timeout) const {
+      auto const ready = detail::protect([&]() noexcept {
+        auto const seconds = timeout
+                                 ? ::rb_float_new(std::chrono::duration<double>(*timeout).count())
+                                 : RUBY_Qnil;
+        return ::rb_io_wait(as_VALUE(), RB_INT2NUM(static_cast<int>(events)), seconds);
+      });
+      // rb_io_wait returns false on timeout.
+      return RB_INTEGER_TYPE_P(ready) ? static_cast<Events>(RB_NUM2INT(ready)) : Events{};
     }
+
   }
 
-#ifdef RCX_IO_BUFFER
-  /// IOBuffer
-  namespace value {
+  namespace detail {
+    /**
+     * Performs a system call on an IO without the GVL, retrying on interrupts.
+     *
+     * The system call is retried after `EINTR`, and after waiting for the IO to be ready on
+     * `EAGAIN`. Pending interrupts are checked while retrying. The wait is bounded by
+     * `IO#timeout`, and `IO::TimeoutError` is raised when it expires.
+     */
+    template <std::invocable<int> S>
+    inline size_t io_syscall(
+        IO io, IO::Events events, char const *RCX_Nonnull name, S syscall RCX_LOCATION_DEF) {
+      auto const fd = io.descriptor();
+      while(true) {
+        auto const result = gvl::without_gvl(
+            [&]() noexcept {
+              auto const n = syscall(fd);
+              return std::pair{n, errno};
+            },
+            std::optional(gvl::ubf_io), gvl::ReleaseFlags::IntrFail RCX_LOCATION_ARG);
+        if(!result) {
+          gvl::check_interrupts();
+          continue;
+        }
 
-    inline IOBuffer IOBuffer::new_internal(size_t size) {
-      return detail::unsafe_coerce<IOBuffer>(detail::protect([size]() noexcept {
-        // Let Ruby allocate a buffer
-        return ::rb_io_buffer_new(nullptr, size, RB_IO_BUFFER_INTERNAL);
-      }));
+        auto const [n, err] = *result;
+        if(n >= 0) {
+          return static_cast<size_t>(n);
+        } else if(err == EINTR) {
+          gvl::check_interrupts();
+        } else if(err == EAGAIN || err == EWOULDBLOCK) {
+          if(io.wait(events) == IO::Events{}) {
+#ifdef RUBY_IO_TIMEOUT_DEFAULT
+            auto const timeout_error = builtin::IOTimeoutError;
+#else
+            auto const timeout_error = builtin::IOError;
+#endif
+            throw Exception::format(timeout_error, "Timed out waiting for IO to become {}!",
+                (events & IO::Events::Writable) == IO::Events{} ? "readable" : "writable");
+          }
+        } else {
+          throw Exception::new_from_errno(name, err);
+        }
+      }
     }
 
-    inline IOBuffer IOBuffer::new_mapped(size_t size) {
-      return detail::unsafe_coerce<IOBuffer>(detail::protect([size]() noexcept {
-        // Let Ruby allocate a buffer
-        return ::rb_io_buffer_new(nullptr, size, RB_IO_BUFFER_MAPPED);
-      }));
+#ifdef RCX_IO_BUFFER
+    /**
+     * Transfers the whole span with a positional system call, retrying partial transfers.
+     */
+    template <typename B, std::invocable<int, B *, size_t, off_t> S>
+    inline size_t positional_io(IO io, std::span<B> bytes, size_t offset, S syscall,
+        IO::Events events, char const *RCX_Nonnull name RCX_LOCATION_DEF) {
+      size_t done = 0;
+      while(done < bytes.size()) {
+        auto const n = io_syscall(
+            io, events, name,
+            [&](int fd) {
+              return syscall(
+                  fd, bytes.data() + done, bytes.size() - done, static_cast<off_t>(offset + done));
+            } RCX_LOCATION_ARG);
+        if(n == 0) {
+          break;
+        }
+        done += n;
+      }
+      return done;
     }
 
-    template <size_t N> inline IOBuffer IOBuffer::new_external(std::span<std::byte, N> bytes) {
-      return detail::unsafe_coerce<IOBuffer>(detail::protect([bytes]() noexcept {
-        return ::rb_io_buffer_new(bytes.data(), bytes.size(), RB_IO_BUFFER_EXTERNAL);
-      }));
+    inline std::optional<size_t> scheduler_io_result(VALUE result, char const *RCX_Nonnull name) {
+      if(result == RUBY_Qundef) {
+        return std::nullopt;
+      }
+      auto const n = detail::protect(
+          [&]() noexcept { return ::rb_fiber_scheduler_io_result_apply(result); });
+      if(n < 0) {
+        throw Exception::new_from_errno(name);
+      }
+      return static_cast<size_t>(n);
     }
+#endif
 
-    template <size_t N>
-    inline IOBuffer IOBuffer::new_external(std::span<std::byte const, N> bytes) {
-      return detail::unsafe_coerce<IOBuffer>(detail::protect([bytes]() noexcept {
-        return ::rb_io_buffer_new(const_cast<std::byte *>(bytes.data()), bytes.size(),
-            static_cast<rb_io_buffer_flags>(RB_IO_BUFFER_EXTERNAL | RB_IO_BUFFER_READONLY));
-      }));
-    }
+    /**
+     * Writes the Strings with `writev`, retrying partial writes.
+     *
+     * The Strings are pinned in batches on the stack while the GVL is released.
+     */
+    template <std::invocable<size_t> F>
+    inline size_t writev_strings(
+        IO io, size_t count, F &&string_at RCX_LOCATION_DEF) {
+#ifdef IOV_MAX
+      constexpr size_t iov_max = IOV_MAX;
+#else
+      constexpr size_t iov_max = _XOPEN_IOV_MAX;
+#endif
+      constexpr size_t batch = std::min<size_t>(iov_max, 256);
+
+      detail::protect(detail::assume_noexcept(::rb_io_flush), io.as_VALUE());
+
+      size_t total = 0;
+      for(size_t i = 0; i < count;) {
+        std::array<std::optional<PinnedBytes>, batch> pins;
+        std::array<::iovec, batch> iov;
+        size_t n_iov = 0;
+        for(size_t n_pins = 0; i < count && n_iov < batch; ++i) {
+          String const string = string_at(i);
+          if(string.size() == 0) {
+            continue;  // not pinned, so that pins never outnumber the iovecs
+          }
+          // The same mutable String may appear more than once, but can be locked only once.
+          auto const pinned = std::ranges::find_if(pins.begin(), pins.begin() + n_pins,
+              [&](auto const &pin) { return pin->string().as_VALUE() == string.as_VALUE(); });
+          auto const bytes = pinned != pins.begin() + n_pins
+                                 ? (*pinned)->bytes()
+                                 : pins[n_pins++].emplace(string).bytes();
+          iov[n_iov++] = {const_cast<std::byte *>(bytes.data()), bytes.size()};
+        }
 
-    inline void IOBuffer::free() const {
-      detail::protect([this]() noexcept { ::rb_io_buffer_free(as_VALUE()); });
+        for(auto rest = std::span(iov.data(), n_iov); !rest.empty();) {
+          auto n = io_syscall(io, IO::Events::Writable, "writev", [&](int fd) {
+            return ::writev(fd, rest.data(), static_cast<int>(rest.size()));
+          } RCX_LOCATION_ARG);
+          total += n;
+          while(!rest.empty() && n >= rest.front().iov_len) {
+            n -= rest.front().iov_len;
+            rest = rest.subspan(1);
+          }
+          if(n > 0) {
+            rest.front().iov_base = static_cast<std::byte *>(rest.front().iov_base) + n;
+            rest.front().iov_len -= n;
+          }
+        }
+      }
+      return total;
     }
+  }
 
-    inline void IOBuffer::resize(size_t size) const {
-      detail::protect([this, size]() noexcept { ::rb_io_buffer_resize(as_VALUE(), size); });
-    }
+  namespace value {
+#ifdef RCX_IO_BUFFER
+    inline size_t IO::pread_into(
+        IOBuffer buffer, size_t offset RCX_LOCATION_DEF) const {
+      check_readable();
+
+      auto const scheduler = detail::protect(
+          []() noexcept { return ::rb_fiber_scheduler_current(); });
+      if(!RB_NIL_P(scheduler)) {
+        auto const result = detail::protect([&]() noexcept {
+          return ::rb_fiber_scheduler_io_pread(scheduler, as_VALUE(),
+              static_cast<rb_off_t>(offset), buffer.as_VALUE(), buffer.cbytes().size(), 0);
+        });
+        if(auto const n = detail::scheduler_io_result(result, "pread")) {
+          return *n;
+        }
+      }
+
+      IOBufferGuard const guard(buffer);
+      return detail::positional_io(
+          *this, guard.bytes(), offset, ::pread, Events::Readable, "pread" RCX_LOCATION_ARG);
+    }
+
+    inline size_t IO::pwrite_from(
+        IOBuffer buffer, size_t offset RCX_LOCATION_DEF) const {
+      check_writable();
+
+      auto const scheduler = ::rcx::detail::protect(
+          []() noexcept { return ::rb_fiber_scheduler_current(); });
+      if(!RB_NIL_P(scheduler)) {
+        auto const result = ::rcx::detail::protect([&]() noexcept {
+          return ::rb_fiber_scheduler_io_pwrite(scheduler, as_VALUE(),
+              static_cast<rb_off_t>(offset), buffer.as_VALUE(), buffer.cbytes().size(), 0);
+        });
+        if(auto const n = detail::scheduler_io_result(result, "pwrite")) {
+          return *n;
+        }
+      }
+
+      IOBufferGuard const guard(buffer);
+      return detail::positional_io(
+          *this, guard.cbytes(), offset, ::pwrite, Events::Writable, "pwrite" RCX_LOCATION_ARG);
+    }
+#endif
+
+    inline size_t IO::writev(
+        std::span<String const> strings RCX_LOCATION_DEF) const {
+      check_writable();
+      return detail::writev_strings(
+          *this, strings.size(), [&](size_t i) { return strings[i]; } RCX_LOCATION_ARG);
+    }
+
+    inline size_t IO::writev(Array strings RCX_LOCATION_DEF) const {
+      check_writable();
+      return detail::writev_strings(*this, strings.size(), [&](size_t i) {
+        return from_Value<String>(strings[i]);
+      } RCX_LOCATION_ARG);
+    }
+
+    inline size_t IO::copy_range(
+        IO from, IO to, size_t offset, size_t length RCX_LOCATION_DEF) {
+      from.check_readable();
+      to.check_writable();
+      detail::protect(detail::assume_noexcept(::rb_io_flush), to.as_VALUE());
+
+      enum class Method { CopyFileRange, Sendfile, ReadWrite };
+      // Falls back to the next method if the kernel or the file types do not support it.
+      auto method = Method::CopyFileRange;
+      [[maybe_unused]] auto const unsupported = [](int err) {
+        return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP;
+      };
+      // copy_file_range fails with EBADF and sendfile with EINVAL on a file opened for appending.
+      if(auto const flags = ::fcntl(to.descriptor(), F_GETFL); flags >= 0 && (flags & O_APPEND)) {
+        method = Method::ReadWrite;
+      }
+
+      auto const in_fd = from.descriptor();
+      size_t done = 0;
+      while(done < length) {
+        auto const position = offset + done;
+        auto const count = std::min<size_t>(length - done, 0x7ffff000);
+        auto const transfer = [&](int out_fd) {
+#if HAVE_COPY_FILE_RANGE
+          if(method == Method::CopyFileRange) {
+            auto in_offset = static_cast<off_t>(position);
+            auto const n = ::copy_file_range(in_fd, &in_offset, out_fd, nullptr, count, 0);
+            if(n >= 0 || !unsupported(errno)) {
+              return n;
+            }
+          }
+#endif
+          method = std::max(method, Method::Sendfile);
+#if HAVE_SENDFILE
+          if(method == Method::Sendfile) {
+            auto in_offset = static_cast<off_t>(position);
+            auto const n = ::sendfile(out_fd, in_fd, &in_offset, count);
+            if(n >= 0 || !unsupported(errno)) {
+              return n;
+            }
+          }
+#endif
+          method = Method::ReadWrite;
+          // Only the written part is counted, and the rest is read again in the next round.
+          std::array<std::byte, 16384> buffer;
+          auto const n = ::pread(in_fd, buffer.data(), std::min(count, buffer.size()),
+              static_cast<off_t>(position));
+          if(n <= 0) {
+            return n;
+          }
+          return ::write(out_fd, buffer.data(), static_cast<size_t>(n));
+        };
+        auto const n =
+            detail::io_syscall(to, Events::Writable, "copy_range", transfer RCX_LOCATION_ARG);
+        if(n == 0) {
+          break;
+        }
+        done += n;
+      }
+      return done;
+    }
+  }
+
+  namespace convert {
+    inline IO FromValue<IO>::convert(Value value) {
+      if(!value.is_kind_of(builtin::IO)) {
+        throw Exception::format(
+            builtin::TypeError, "Expected an IO but got a {}", value.get_class());
+      }
+      return detail::unsafe_coerce<IO>(value.as_VALUE());
+    }
+  }
+
+#ifdef RCX_IO_BUFFER
+  /// IOBuffer
+  namespace value {
+
+    inline IOBuffer IOBuffer::new_internal(size_t size) {
+      return detail::unsafe_coerce<IOBuffer>(detail::protect([size]() noexcept {
+        // Let Ruby allocate a buffer
+        return ::rb_io_buffer_new(nullptr, size, RB_IO_BUFFER_INTERNAL);
+      }));
+    }
+
+    inline IOBuffer IOBuffer::new_mapped(size_t size) {
+      return detail::unsafe_coerce<IOBuffer>(detail::protect([size]() noexcept {
+        // Let Ruby allocate a buffer
+        return ::rb_io_buffer_new(nullptr, size, RB_IO_BUFFER_MAPPED);
+      }));
+    }
+
+    inline IOBuffer IOBuffer::map_file(
+        IO io, size_t offset, std::optional<size_t> length, MapFlags flags) {
+      if(!length) {
+        struct stat st;
+        if(::fstat(io.descriptor(), &st) != 0) {
+          throw Exception::new_from_errno("fstat");
+        }
+        auto const size = static_cast<size_t>(st.st_size);
+        if(offset > size) {
+          throw Exception::format(builtin::ArgumentError,
+              "Offset {} is beyond the end of the file of {} bytes", offset, size);
+        }
+        length = size - offset;
+      }
+
+      auto const buffer_flags = static_cast<rb_io_buffer_flags>(
+          (flags & MapFlags::Private) == MapFlags::Private ? RB_IO_BUFFER_PRIVATE
+                                                           : RB_IO_BUFFER_READONLY);
+      IOBuffer const buffer = detail::unsafe_coerce<IOBuffer>(detail::protect([&]() noexcept {
+        return ::rb_io_buffer_map(
+            io.as_VALUE(), *length, static_cast<rb_off_t>(offset), buffer_flags);
+      }));
+
+#if HAVE_MADVISE
+      auto const bytes = buffer.cbytes();
+      auto const advise = [&](MapFlags flag, int advice) {
+        if((flags & flag) == flag) {
+          ::madvise(const_cast<std::byte *>(bytes.data()), bytes.size(), advice);
+        }
+      };
+      advise(MapFlags::Sequential, MADV_SEQUENTIAL);
+      advise(MapFlags::WillNeed, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+      advise(MapFlags::HugePage, MADV_HUGEPAGE);
+#endif
+#endif
+
+      return buffer;
+    }
+
+    template <size_t N> inline IOBuffer IOBuffer::new_external(std::span<std::byte, N> bytes) {
+      return detail::unsafe_coerce<IOBuffer>(detail::protect([bytes]() noexcept {
+        return ::rb_io_buffer_new(bytes.data(), bytes.size(), RB_IO_BUFFER_EXTERNAL);
+      }));
+    }
+
+    template <size_t N>
+    inline IOBuffer IOBuffer::new_external(std::span<std::byte const, N> bytes) {
+      return detail::unsafe_coerce<IOBuffer>(detail::protect([bytes]() noexcept {
+        return ::rb_io_buffer_new(const_cast<std::byte *>(bytes.data()), bytes.size(),
+            static_cast<rb_io_buffer_flags>(RB_IO_BUFFER_EXTERNAL | RB_IO_BUFFER_READONLY));
+      }));
+    }
+
+    inline void IOBuffer::free() const {
+      detail::protect([this]() noexcept { ::rb_io_buffer_free(as_VALUE()); });
+    }
+
+    inline void IOBuffer::resize(size_t size) const {
+      detail::protect([this, size]() noexcept { ::rb_io_buffer_resize(as_VALUE(), size); });
+    }
 
     inline std::span<std::byte> IOBuffer::bytes() const {
       void *ptr;
@@ -1133,12 +1903,14 @@ namespace rcx {
     }
 
     inline bool IOBuffer::try_lock() const {
-      try {
-        lock();
-        return true;
-      } catch(Exception const &) {
+      void *ptr;
+      size_t size;
+      // rb_io_buffer_get_bytes does not raise, unlike rb_io_buffer_lock on a locked buffer.
+      if(::rb_io_buffer_get_bytes(as_VALUE(), &ptr, &size) & RB_IO_BUFFER_LOCKED) {
         return false;
       }
+      lock();
+      return true;
     }
   }
 
@@ -1243,6 +2015,47 @@ namespace rcx {
     return detail::unsafe_coerce<Array>(value.as_VALUE());
   }
 
+  namespace detail {
+    // IDs of the enumerators. A Symbol VALUE may be a heap object when the name was first created
+    // as a dynamic Symbol, so only IDs, which are never collected once interned, are cached.
+    template <concepts::SymbolEnum E> inline ID enum_id(size_t i) {
+      static constinit std::array<std::atomic<ID>, std::size(EnumTraits<E>::symbols)> ids{};
+      return publish_once(
+          ids[i], [i] { return into_ID(std::string_view(EnumTraits<E>::symbols[i].second)); });
+    }
+  }
+
+  template <concepts::SymbolEnum E> inline E FromValue<E>::convert(Value value) {
+    auto const v = value.as_VALUE();
+    if(RB_SYMBOL_P(v)) {
+      // Compared as Symbols, since rb_sym2id would pin every dynamic Symbol given. The Symbol of
+      // an interned ID is unique, so a matching dynamic Symbol is the same object.
+      for(size_t i = 0; i < std::size(EnumTraits<E>::symbols); ++i) {
+        if(RB_ID2SYM(detail::enum_id<E>(i)) == v) {
+          return EnumTraits<E>::symbols[i].first;
+        }
+      }
+    }
+
+    std::string expected;
+    for(auto const &[_, name]: EnumTraits<E>::symbols) {
+      expected += expected.empty() ? ":" : ", :";
+      expected += name;
+    }
+    throw Exception::format(
+        builtin::ArgumentError, "Invalid value {:#}; expected one of {}", value, expected);
+  }
+
+  template <concepts::SymbolEnum E> inline Value IntoValue<E>::convert(E value) {
+    for(size_t i = 0; i < std::size(EnumTraits<E>::symbols); ++i) {
+      if(EnumTraits<E>::symbols[i].first == value) {
+        return detail::unsafe_coerce<Value>(RB_ID2SYM(detail::enum_id<E>(i)));
+      }
+    }
+    throw Exception::format(builtin::RangeError, "Enumerator {} has no corresponding Symbol",
+        static_cast<std::underlying_type_t<E>>(value));
+  }
+
   template <concepts::ConvertibleFromValue T>
   decltype(auto) FromValue<std::optional<T>>::convert(Value v) {
     return v.is_nil() ? std::optional<T>{} : from_Value<T>(v);
@@ -1284,12 +2097,25 @@ namespace rcx {
       return String::copy_from(s);
     }
 
+    // Template parameter objects have static storage duration.
+    template <detail::cxstring s> String operator""_sstr() {
+      return String::new_static(s);
+    }
+
+    template <detail::u8cxstring s> String operator""_sstr() {
+      return String::new_static(s);
+    }
+
     template <detail::cxstring s> String operator""_fstr() {
-      return String::intern_from(s);
+      static constinit std::atomic<VALUE> str{};
+      return detail::unsafe_coerce<String>(
+          detail::publish_once(str, [] { return detail::leak_fstring(String::intern_from(s)); }));
     }
 
     template <detail::u8cxstring s> String operator""_fstr() {
-      return String::intern_from(s);
+      static constinit std::atomic<VALUE> str{};
+      return detail::unsafe_coerce<String>(
+          detail::publish_once(str, [] { return detail::leak_fstring(String::intern_from(s)); }));
     }
 
     template <detail::cxstring s> Symbol operator""_sym() {
@@ -1299,19 +2125,22 @@ namespace rcx {
 
     template <detail::u8cxstring s> Symbol operator""_sym() {
       return detail::unsafe_coerce<Symbol>(
-          detail::protect([&]() noexcept { return ::rb_id2sym(operator""_id < s>().as_VALUE()); }));
+          detail::protect([&]() noexcept { return ::rb_id2sym(operator""_id < s>().as_ID()); }));
     }
 
     template <detail::cxstring s> Id operator""_id() {
-      static Id const id{
-        detail::protect([&]() noexcept { return ::rb_intern2(s.data(), s.size()); })};
-      return id;
+      static constinit std::atomic<ID> id{};
+      return Id(detail::publish_once(id, [] {
+        return detail::protect([]() noexcept { return ::rb_intern2(s.data(), s.size()); });
+      }));
     }
 
     template <detail::u8cxstring s> Id operator""_id() {
-      static Id const id{detail::protect(
-          [&]() noexcept { return ::rb_intern_str(operator""_fstr < s>().as_VALUE()); })};
-      return id;
+      static constinit std::atomic<ID> id{};
+      return Id(detail::publish_once(id, [] {
+        return detail::protect(
+            []() noexcept { return ::rb_intern_str(operator""_fstr < s>().as_VALUE()); });
+      }));
     }
 
   }
@@ -1372,6 +2201,428 @@ namespace rcx {
     }
   }
 
+  // Yielder
+
+  template <concepts::ConvertibleFromValue R>
+  inline R Yielder::yield(concepts::ConvertibleIntoValue auto &&...args) const {
+    std::array<VALUE, sizeof...(args)> const argv{
+      into_Value(std::forward<decltype(args)>(args)).as_VALUE()...};
+    return from_Value<R>(detail::unsafe_coerce<Value>(detail::protect([&]() noexcept {
+      return ::rb_yield_values2(argv.size(), argv.data());
+    })));
+  }
+
+  inline Proc Yielder::to_proc() const {
+    return detail::unsafe_coerce<Proc>(
+        detail::protect([]() noexcept { return ::rb_block_proc(); }));
+  }
+
+  // Enumerate
+
+  namespace detail {
+    template <typename R> inline constexpr bool is_owning_view_v = false;
+    template <typename C>
+    inline constexpr bool is_owning_view_v<std::ranges::owning_view<C>> = true;
+
+    template <typename R> struct EnumerableRange: typed_data::WrappedStruct<> {
+      R range;
+      bool iterated = false;
+
+      explicit EnumerableRange(R &&range): range(std::move(range)) {
+      }
+
+      void each(Yielder yielder) {
+        if constexpr(!std::ranges::forward_range<R>) {
+          if(iterated) {
+            throw Exception::format(
+                builtin::RuntimeError, "This range cannot be iterated more than once");
+          }
+        }
+        iterated = true;
+        for(auto &&element: range) {
+          yielder.yield(std::forward<decltype(element)>(element));
+        }
+      }
+
+      // Marks the Ruby values stored in the container owned by the range. Other views are not
+      // iterated, as that could run arbitrary code during GC.
+      friend void dmark(gc::Gc gc, EnumerableRange *RCX_Nonnull self) noexcept {
+        auto &container = [&]() -> auto & {
+          if constexpr(is_owning_view_v<R>) {
+            return self->range.base();
+          } else {
+            return self->range;
+          }
+        }();
+        using Container = std::remove_reference_t<decltype(container)>;
+        if constexpr(!std::ranges::view<Container> &&
+                     std::derived_from<std::ranges::range_value_t<Container>, ValueBase> &&
+                     std::is_same_v<std::ranges::range_reference_t<Container>,
+                         std::ranges::range_value_t<Container> &>) {
+          for(auto &element: container) {
+            gc.mark_movable(element);
+          }
+        }
+      }
+
+      static ClassT<EnumerableRange> bound_class() {
+        static Leak<ClassT<EnumerableRange>> const klass{[] {
+          ClassT<EnumerableRange> const klass =
+              detail::unsafe_coerce<ClassT<EnumerableRange>>(Class::new_class().as_VALUE());
+          typed_data::DataType<EnumerableRange>::bind(klass);
+          using namespace literals;
+          return klass.define_method(
+              "each"_id, [](EnumerableRange &self, Yielder yielder) { self.each(yielder); },
+              args::yield_block);
+        }()};
+        return *klass;
+      }
+    };
+  }
+
+  namespace convert {
+    template <typename R> inline Value IntoValue<Enumerate<R>>::convert(Enumerate<R> &value) {
+      using Holder = detail::EnumerableRange<R>;
+      auto const obj = Holder::bound_class().allocate();
+      typed_data::DataType<Holder>::initialize(obj, std::move(value.range));
+
+      rb_enumerator_size_func *RCX_Nullable size = nullptr;
+      if constexpr(std::ranges::sized_range<R>) {
+        size = [](VALUE obj, VALUE, VALUE) -> VALUE {
+          auto &holder = *static_cast<Holder *>(RTYPEDDATA_DATA(obj));
+          return RB_SIZE2NUM(std::ranges::size(holder.range));
+        };
+      }
+
+      using namespace literals;
+      auto const each = RB_ID2SYM("each"_id.as_ID());
+      return detail::unsafe_coerce<Value>(detail::protect([&]() noexcept {
+        return ::rb_enumeratorize_with_size(obj.as_VALUE(), each, 0, nullptr, size);
+      }));
+    }
+  }
+
+  // DeferredException
+
+  inline std::string const &DeferredException::message() const {
+    if(!message_) {
+      message_ = format_message();
+    }
+    return *message_;
+  }
+
+  inline char const *RCX_Nonnull DeferredException::what() const noexcept {
+    try {
+      return message().c_str();
+    } catch(...) {
+      return "";
+    }
+  }
+
+  inline Exception DeferredException::new_exception() const {
+    return exception_class().new_instance(String::copy_from(message()).freeze());
+  }
+
+  namespace detail {
+    template <typename... Args>
+    template <typename... A>
+    inline DeferredFormat<Args...>::DeferredFormat(
+        ClassT<Exception> cls, std::string_view fmt, A &&...args)
+        : cls_(cls), fmt_(fmt), args_(std::forward<A>(args)...) {
+    }
+
+    template <typename... Args>
+    inline std::string DeferredFormat<Args...>::format_message() const {
+      return std::apply(
+          [&](auto const &...args) { return std::vformat(fmt_, std::make_format_args(args...)); },
+          args_);
+    }
+
+    template <typename... Args>
+    inline ClassT<Exception> DeferredFormat<Args...>::exception_class() const noexcept {
+      return cls_;
+    }
+  }
+
+  // PinnedBytes
+
+  inline PinnedBytes::PinnedBytes(String string)
+      : string_(string.is_frozen() ? string : string.lock()),
+        bytes_(reinterpret_cast<std::byte const *>(string_.cdata()), string_.size()),
+        locked_(!string.is_frozen()) {
+  }
+
+  inline PinnedBytes::~PinnedBytes() {
+    if(!locked_) {
+      return;
+    }
+    try {
+      string_.unlock();
+    } catch(...) {
+      // The string is locked by this guard, so unlocking cannot fail in practice.
+    }
+  }
+
+  inline String PinnedBytes::string() const noexcept {
+    return string_;
+  }
+
+  inline std::span<std::byte const> PinnedBytes::bytes() const noexcept {
+    return bytes_;
+  }
+
+#ifdef RCX_IO_BUFFER
+  // IOBufferGuard
+
+  inline IOBufferGuard::IOBufferGuard(IOBuffer buffer): buffer_(buffer) {
+    buffer_.lock();
+    view();
+  }
+
+  inline IOBufferGuard::IOBufferGuard(IOBuffer buffer, std::adopt_lock_t) noexcept
+      : buffer_(buffer) {
+    view();
+  }
+
+  inline void IOBufferGuard::view() noexcept {
+    void *ptr;
+    size_t size;
+    auto const flags = ::rb_io_buffer_get_bytes(buffer_.as_VALUE(), &ptr, &size);
+    bytes_ = {static_cast<std::byte *>(ptr), size};
+    writable_ = !(flags & RB_IO_BUFFER_READONLY);
+  }
+
+  inline IOBufferGuard::~IOBufferGuard() {
+    try {
+      buffer_.unlock();
+    } catch(...) {
+      // The buffer is locked by this guard, so unlocking cannot fail in practice.
+    }
+  }
+
+  inline IOBuffer IOBufferGuard::buffer() const noexcept {
+    return buffer_;
+  }
+
+  inline std::span<std::byte> IOBufferGuard::bytes() const {
+    if(!writable_) {
+      throw std::runtime_error{"IO::Buffer is read-only"};
+    }
+    return bytes_;
+  }
+
+  inline std::span<std::byte> IOBufferGuard::bytes(size_t offset, size_t length) const {
+    auto const whole = bytes();
+    if(offset > whole.size() || length > whole.size() - offset) {
+      throw std::out_of_range{"Range is out of IO::Buffer"};
+    }
+    return whole.subspan(offset, length);
+  }
+
+  inline std::span<std::byte const> IOBufferGuard::cbytes() const noexcept {
+    return bytes_;
+  }
+
+  inline std::span<std::byte const> IOBufferGuard::cbytes(size_t offset, size_t length) const {
+    if(offset > bytes_.size() || length > bytes_.size() - offset) {
+      throw std::out_of_range{"Range is out of IO::Buffer"};
+    }
+    return cbytes().subspan(offset, length);
+  }
+
+  // IOBufferPool
+
+  inline IOBufferPool::Lease::Lease(IOBufferPool &pool, IOBuffer buffer) noexcept
+      : pool_(&pool), buffer_(buffer) {
+  }
+
+  inline IOBufferPool::Lease::Lease(Lease &&other) noexcept
+      : pool_(std::exchange(other.pool_, nullptr)),
+        buffer_(std::exchange(other.buffer_, std::nullopt)) {
+  }
+
+  inline IOBufferPool::Lease &IOBufferPool::Lease::operator=(Lease &&other) noexcept {
+    if(this != &other) {
+      release();
+      pool_ = std::exchange(other.pool_, nullptr);
+      buffer_ = std::exchange(other.buffer_, std::nullopt);
+    }
+    return *this;
+  }
+
+  inline IOBufferPool::Lease::~Lease() {
+    release();
+  }
+
+  inline IOBuffer IOBufferPool::Lease::buffer() const {
+    if(!buffer_) {
+      throw std::runtime_error{"Lease has been released"};
+    }
+    return *buffer_;
+  }
+
+  inline void IOBufferPool::Lease::release() noexcept {
+    if(pool_ && buffer_) {
+      pool_->give_back(*buffer_);
+    }
+    pool_ = nullptr;
+    buffer_.reset();
+  }
+
+  namespace detail {
+    // Set when the VM is destructed, after which the destructors of objects with static storage
+    // duration must not call Ruby.
+    inline bool vm_destructed = false;
+
+    inline void watch_vm_destruction() {
+      static bool const watching = [] {
+        ::ruby_vm_at_exit([](ruby_vm_t *) { vm_destructed = true; });
+        return true;
+      }();
+      static_cast<void>(watching);
+    }
+  }
+
+  inline IOBufferPool::IOBufferPool(size_t min_size, size_t max_size, Clock::duration idle_timeout)
+      : idle_(RUBY_Qnil), idle_timeout_(idle_timeout), last_trim_(Clock::now()) {
+    for(auto size = std::bit_ceil(std::max<size_t>(min_size, 1)); size <= max_size; size *= 2) {
+      classes_.push_back({size, {}});
+    }
+    VALUE const idle = detail::protect([this]() noexcept {
+      auto const idle = ::rb_ary_new_capa(static_cast<long>(classes_.size()));
+      for(size_t i = 0; i < classes_.size(); ++i) {
+        ::rb_ary_push(idle, ::rb_ary_new());
+      }
+      return idle;
+    });
+    idle_ = idle;
+    ::rb_gc_register_address(&idle_);
+    detail::watch_vm_destruction();
+  }
+
+  inline IOBufferPool::~IOBufferPool() {
+    if(detail::vm_destructed) {
+      return;
+    }
+    try {
+      Array const idle = detail::unsafe_coerce<Array>(idle_);
+      for(size_t i = 0; i < classes_.size(); ++i) {
+        auto const buffers = idle.at<Array>(i);
+        for(size_t j = 0; j < buffers.size(); ++j) {
+          buffers.at<IOBuffer>(j).free();
+        }
+      }
+    } catch(...) {
+      // Leave the rest to the GC.
+    }
+    ::rb_gc_unregister_address(&idle_);
+  }
+
+  inline IOBufferPool::Lease IOBufferPool::acquire(size_t size) {
+    trim_if_due();
+
+    auto const it =
+        std::ranges::find_if(classes_, [size](auto const &c) { return c.size >= size; });
+    auto const create = [](size_t size) {
+      return size >= 64 * 1024 ? IOBuffer::new_mapped(size) : IOBuffer::new_internal(size);
+    };
+    if(it == classes_.end()) {
+      return Lease(*this, create(size));
+    }
+    if(it->released.empty()) {
+      return Lease(*this, create(it->size));
+    }
+
+    auto const idle = RARRAY_AREF(idle_, it - classes_.begin());
+    auto const buffer = detail::protect(detail::assume_noexcept(::rb_ary_pop), idle);
+    if(RB_NIL_P(buffer)) {
+      return Lease(*this, create(it->size));
+    }
+    it->released.pop_back();
+    return Lease(*this, detail::unsafe_coerce<IOBuffer>(buffer));
+  }
+
+  inline void IOBufferPool::give_back(IOBuffer buffer) noexcept {
+    // Ruby objects must not be touched while they are being swept.
+    if(::rb_during_gc()) {
+      return;
+    }
+
+    void *ptr;
+    size_t size;
+    // rb_io_buffer_get_bytes does not raise, unlike the calls below on a locked buffer.
+    if((::rb_io_buffer_get_bytes(buffer.as_VALUE(), &ptr, &size) & RB_IO_BUFFER_LOCKED) || !ptr) {
+      // Locked or freed by the user. Leave it to the GC.
+      return;
+    }
+
+    // Only C functions are called, so that no interrupt is checked and swallowed here.
+    try {
+      auto const it =
+          std::ranges::find_if(classes_, [size](auto const &c) { return c.size == size; });
+      if(it == classes_.end()) {
+        // Not pooled, or resized by the user.
+        buffer.free();
+        return;
+      }
+
+      // Take the storage away from the object that the user may still reference.
+      auto const fresh =
+          detail::protect(detail::assume_noexcept(::rb_io_buffer_transfer), buffer.as_VALUE());
+      auto const idle = RARRAY_AREF(idle_, it - classes_.begin());
+      detail::protect([&]() noexcept { ::rb_ary_push(idle, fresh); });
+      it->released.push_back(Clock::now());
+      trim_if_due();
+    } catch(Exception const &) {
+      // Allocation failed. Leave the buffer to the GC.
+    }
+  }
+
+  inline void IOBufferPool::trim_if_due() {
+    if(Clock::now() - last_trim_ >= idle_timeout_) {
+      trim();
+    }
+  }
+
+  inline void IOBufferPool::trim() {
+    auto const now = Clock::now();
+    last_trim_ = now;
+    for(size_t i = 0; i < classes_.size(); ++i) {
+      auto &released = classes_[i].released;
+      // The idle buffers are ordered from the oldest.
+      auto const expired = std::ranges::find_if(released, [&](auto const &time) {
+        return now - time < idle_timeout_;
+      }) - released.begin();
+      if(expired == 0) {
+        continue;
+      }
+
+      // No Ruby method is called until the timestamps match the buffers again, so that no other
+      // thread runs in between and sees them out of sync.
+      auto const idle = RARRAY_AREF(idle_, static_cast<long>(i));
+      auto const buffers = detail::unsafe_coerce<Array>(detail::protect([&]() noexcept {
+        auto const buffers = ::rb_ary_subseq(idle, 0, static_cast<long>(expired));
+        for(long j = 0; j < RARRAY_LEN(buffers); ++j) {
+          ::rb_ary_shift(idle);
+        }
+        return buffers;
+      }));
+      released.erase(released.begin(), released.begin() + expired);
+      for(size_t j = 0; j < buffers.size(); ++j) {
+        buffers.at<IOBuffer>(j).free();
+      }
+    }
+  }
+
+  inline size_t IOBufferPool::idle_bytes() const noexcept {
+    size_t total = 0;
+    for(auto const &c: classes_) {
+      total += c.size * c.released.size();
+    }
+    return total;
+  }
+#endif
+
   // Ruby
 
   inline Module Ruby::define_module(concepts::Identifier auto &&name) {
@@ -1387,6 +2638,10 @@ namespace rcx {
     return define_class<T>(std::forward<decltype(name)>(name), builtin::Object);
   }
 
+  inline void Ruby::set_ractor_safe(bool safe) {
+    ::rb_ext_ractor_safe(safe);
+  }
+
   inline Ruby &Ruby::unsafe_get() {
     static Ruby ruby = {};
     return ruby;
@@ -1411,8 +2666,44 @@ namespace rcx {
       return {};
     }
 
+    /**
+     * Table of the Ruby exception classes indexed by C++ exception types.
+     */
+    class ExceptionMap {
+      // Ruby is never called while the lock is held; see publish_once.
+      mutable std::shared_mutex mutex_;
+      std::unordered_map<std::type_index, VALUE> classes_;
+
+    public:
+      void insert(std::type_info const &ti, ClassT<Exception> cls) {
+        auto const value = cls.as_VALUE();
+        protect([value]() noexcept { ::rb_gc_register_mark_object(value); });
+        std::unique_lock const lock(mutex_);
+        classes_.insert_or_assign(ti, value);
+      }
+
+      std::optional<ClassT<Exception>> find(std::type_info const &ti) const {
+        std::shared_lock const lock(mutex_);
+        if(auto const it = classes_.find(ti); it != classes_.end()) {
+          return detail::unsafe_coerce<ClassT<Exception>>(it->second);
+        }
+        return std::nullopt;
+      }
+
+      static ExceptionMap &instance() {
+        static ExceptionMap map;
+        return map;
+      }
+    };
+
     inline Value make_ruby_exception(
         std::exception const *RCX_Nullable exc, std::type_info const *RCX_Nullable ti) {
+      if(ti) {
+        if(auto const cls = ExceptionMap::instance().find(*ti)) {
+          return exc ? cls->new_instance(String::copy_from(exc->what())) : cls->new_instance();
+        }
+      }
+
       std::string name, msg;
       if(ti)
         name = demangle_type_info(*ti);
@@ -1422,32 +2713,271 @@ namespace rcx {
           std::format("{}: {}", name.empty() ? std::string{"unknown"} : name, msg)));
     }
 
+    // Creates the Ruby exception to raise in place of a C++ one. An error raised while creating
+    // it, e.g. by the initialize method of a mapped class, is returned instead, so that the
+    // caller can raise it from a noexcept context. Any other failure falls back to a
+    // RuntimeError with the message of the C++ exception.
+    inline VALUE new_ruby_exception(
+        std::invocable<> auto const &factory, char const *RCX_Nullable what) noexcept {
+      try {
+        return factory().as_VALUE();
+      } catch(Exception const &err) {
+        return err.as_VALUE();
+      } catch(...) {
+        return rb_exc_new_cstr(::rb_eRuntimeError, what ? what : "unknown");
+      }
+    }
+
     inline auto cxx_protect(std::invocable<> auto const &functor) noexcept
         -> std::invoke_result_t<decltype(functor)> {
       try {
         return functor();
       } catch(Jump const &jump) {
+        RCX_PROBE(jump, jump.state);
         ::rb_jump_tag(jump.state);
       } catch(Exception const &exc) {
+        RCX_PROBE(exception, typeid(exc).name(), static_cast<char const *>(nullptr));
         ::rb_exc_raise(exc.as_VALUE());
+      } catch(DeferredException const &exc) {
+        RCX_PROBE(exception, typeid(exc).name(), exc.what());
+        ::rb_exc_raise(new_ruby_exception([&] { return exc.new_exception(); }, exc.what()));
       } catch(std::exception const &exc) {
-        ::rb_exc_raise(make_ruby_exception(&exc, &typeid(exc)).as_VALUE());
+        RCX_PROBE(exception, typeid(exc).name(), exc.what());
+        ::rb_exc_raise(new_ruby_exception(
+            [&] { return make_ruby_exception(&exc, &typeid(exc)); }, exc.what()));
       } catch(...) {
         if constexpr(have_abi_cxa_current_exception_type) {
-          ::rb_exc_raise(
-              make_ruby_exception(nullptr, abi::__cxa_current_exception_type()).as_VALUE());
+          RCX_PROBE(exception, abi::__cxa_current_exception_type()->name(),
+              static_cast<char const *>(nullptr));
+          ::rb_exc_raise(new_ruby_exception(
+              [] { return make_ruby_exception(nullptr, abi::__cxa_current_exception_type()); },
+              nullptr));
         } else {
-          ::rb_exc_raise(make_ruby_exception(nullptr, nullptr).as_VALUE());
+          RCX_PROBE(
+              exception, static_cast<char const *>(nullptr), static_cast<char const *>(nullptr));
+          ::rb_exc_raise(
+              new_ruby_exception([] { return make_ruby_exception(nullptr, nullptr); }, nullptr));
         }
       }
     }
   }
 
+  template <typename E> inline void map_exception(ClassT<Exception> cls) {
+    detail::ExceptionMap::instance().insert(typeid(E), cls);
+  }
+
+#ifdef RCX_METHOD_STATS
+  inline Value method_stats() {
+    using namespace literals;
+    using Stats = detail::MethodStats;
+
+    auto const new_hash = []() {
+      return detail::unsafe_coerce<Value>(
+          detail::protect([]() noexcept { return ::rb_hash_new(); }));
+    };
+    auto const aset = [](Value hash, Value key, Value value) {
+      detail::protect([&]() noexcept {
+        ::rb_hash_aset(hash.as_VALUE(), key.as_VALUE(), value.as_VALUE());
+      });
+    };
+
+    auto const result = new_hash();
+    for(auto const &[name, totals]: Stats::instance().snapshot()) {
+      std::array<Value, Stats::histogram_buckets> histogram;
+      std::ranges::transform(totals.histogram, histogram.begin(),
+          [](std::uint64_t n) { return into_Value(n); });
+
+      auto const entry = new_hash();
+      aset(entry, "calls"_sym, into_Value(totals.calls));
+      aset(entry, "time"_sym, into_Value(static_cast<double>(totals.nanoseconds) / 1e9));
+      aset(entry, "histogram"_sym, Array::new_from(histogram));
+      aset(result, String::copy_from(name), entry);
+    }
+    return result;
+  }
+#endif
+
+  namespace detail {
+#ifdef RCX_GVL_STATS
+    /**
+     * Statistics of the GVL releases by `gvl::without_gvl`, aggregated by the call sites.
+     */
+    class GvlStats {
+    public:
+      struct Totals {
+        std::uint64_t calls = 0;
+        std::uint64_t cancelled = 0;
+        std::uint64_t ubf_calls = 0;
+        std::uint64_t released_nanoseconds = 0;
+        std::uint64_t reacquire_nanoseconds = 0;
+      };
+
+      struct Site {
+        std::atomic<std::uint64_t> calls;
+        std::atomic<std::uint64_t> cancelled;
+        std::atomic<std::uint64_t> ubf_calls;
+        std::atomic<std::uint64_t> released_nanoseconds;
+        std::atomic<std::uint64_t> reacquire_nanoseconds;
+      };
+
+    private:
+      struct Key {
+        char const *RCX_Nonnull file;
+        std::uint_least32_t line;
+        std::uint_least32_t column;
+
+        bool operator==(Key const &) const = default;
+      };
+
+      struct KeyHash {
+        std::size_t operator()(Key const &key) const noexcept {
+          return std::hash<void const *>{}(key.file) ^ (std::size_t{key.line} << 16) ^ key.column;
+        }
+      };
+
+      std::shared_mutex mutex_;
+      std::unordered_map<Key, Site, KeyHash> sites_;
+
+#if HAVE_RB_INTERNAL_THREAD_ADD_EVENT_HOOK
+      std::atomic<std::uint64_t> waits_{};
+      std::atomic<std::uint64_t> wait_nanoseconds_{};
+
+      // Called on the thread that is waiting for or has got the GVL.
+      static void thread_event(rb_event_flag_t event,
+          rb_internal_thread_event_data_t const *RCX_Nonnull, void *RCX_Nullable) {
+        thread_local std::optional<std::chrono::steady_clock::time_point> ready;
+        auto const now = std::chrono::steady_clock::now();
+        if(event == RUBY_INTERNAL_THREAD_EVENT_READY) {
+          ready = now;
+        } else if(ready) {
+          auto &stats = instance();
+          stats.waits_.fetch_add(1, std::memory_order_relaxed);
+          stats.wait_nanoseconds_.fetch_add(elapsed(*ready, now), std::memory_order_relaxed);
+          ready.reset();
+        }
+      }
+
+      GvlStats() {
+        ::rb_internal_thread_add_event_hook(thread_event,
+            RUBY_INTERNAL_THREAD_EVENT_READY | RUBY_INTERNAL_THREAD_EVENT_RESUMED, nullptr);
+      }
+#else
+      GvlStats() = default;
+#endif
+
+    public:
+      static std::uint64_t elapsed(std::chrono::steady_clock::time_point from,
+          std::chrono::steady_clock::time_point to) noexcept {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+      }
+
+      Site &site(std::source_location const &location) {
+        Key const key{location.file_name(), location.line(), location.column()};
+        {
+          std::shared_lock const lock(mutex_);
+          if(auto const it = sites_.find(key); it != sites_.end()) {
+            return it->second;
+          }
+        }
+        std::unique_lock const lock(mutex_);
+        return sites_.try_emplace(key).first->second;
+      }
+
+      /// Sums up the statistics by the file names and the line numbers of the call sites.
+      std::vector<std::pair<std::string, Totals>> snapshot() {
+        std::vector<std::pair<std::string, Totals>> result;
+        std::shared_lock const lock(mutex_);
+        for(auto const &[key, site]: sites_) {
+          auto label = std::format("{}:{}", key.file, key.line);
+          auto const it = std::ranges::find(result, label, &std::pair<std::string, Totals>::first);
+          auto &sum = it != result.end() ? it->second
+                                         : result.emplace_back(std::move(label), Totals{}).second;
+          sum.calls += site.calls.load(std::memory_order_relaxed);
+          sum.cancelled += site.cancelled.load(std::memory_order_relaxed);
+          sum.ubf_calls += site.ubf_calls.load(std::memory_order_relaxed);
+          sum.released_nanoseconds += site.released_nanoseconds.load(std::memory_order_relaxed);
+          sum.reacquire_nanoseconds += site.reacquire_nanoseconds.load(std::memory_order_relaxed);
+        }
+        return result;
+      }
+
+#if HAVE_RB_INTERNAL_THREAD_ADD_EVENT_HOOK
+      /// The number of times threads waited for the GVL and the total time they waited.
+      std::pair<std::uint64_t, std::uint64_t> waits() const noexcept {
+        return {waits_.load(std::memory_order_relaxed),
+          wait_nanoseconds_.load(std::memory_order_relaxed)};
+      }
+#endif
+
+      static GvlStats &instance() {
+        static auto const stats = new GvlStats;  // let it leak
+        return *stats;
+      }
+    };
+
+    /**
+     * Records a GVL release into the statistics of the call site.
+     */
+    class GvlSample {
+      GvlStats::Site &site_;
+      std::chrono::steady_clock::time_point released_;
+      std::chrono::steady_clock::time_point reacquiring_;
+
+      static void add(std::atomic<std::uint64_t> &counter, std::uint64_t n) noexcept {
+        counter.fetch_add(n, std::memory_order_relaxed);
+      }
+
+    public:
+      explicit GvlSample(std::source_location const &location)
+          : site_(GvlStats::instance().site(location)) {
+      }
+
+      void released() noexcept {
+        released_ = std::chrono::steady_clock::now();
+      }
+
+      void reacquiring() noexcept {
+        reacquiring_ = std::chrono::steady_clock::now();
+      }
+
+      void unblocked() noexcept {
+        add(site_.ubf_calls, 1);
+      }
+
+      void acquired(bool executed) noexcept {
+        add(site_.calls, 1);
+        if(executed) {
+          add(site_.released_nanoseconds, GvlStats::elapsed(released_, reacquiring_));
+          add(site_.reacquire_nanoseconds,
+              GvlStats::elapsed(reacquiring_, std::chrono::steady_clock::now()));
+        } else {
+          add(site_.cancelled, 1);
+        }
+      }
+    };
+#else
+    struct GvlSample {
+      GvlSample() noexcept {
+      }
+      void released() noexcept {
+      }
+      void reacquiring() noexcept {
+      }
+      void unblocked() noexcept {
+      }
+      void acquired(bool) noexcept {
+      }
+    };
+#endif
+  }
+
   namespace gvl {
     template <std::invocable<> F, std::invocable<> U>
-    auto without_gvl(F callback, std::optional<U> ubf, ReleaseFlags flags) noexcept(noexcept(
-        callback(), (*ubf)())) -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
-        std::optional<std::invoke_result_t<F>>> {
+    auto without_gvl(F callback, std::optional<U> ubf, ReleaseFlags flags RCX_LOCATION_DEF)
+        noexcept(noexcept(callback(), (*ubf)()))
+        -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
+            std::optional<std::invoke_result_t<F>>> {
 
       using ResultType = std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, std::monostate,
           std::optional<std::invoke_result_t<F>>>;
@@ -1456,21 +2986,30 @@ namespace rcx {
         F callback;
         [[no_unique_address]] ResultType result;
         std::exception_ptr exception;
+        detail::GvlSample &sample;
       };
 
       struct UbfData {
         U ubf;
         std::exception_ptr exception;
+        detail::GvlSample &sample;
       };
 
-      CallbackData data{std::move(callback), ResultType{}, nullptr};
+#ifdef RCX_GVL_STATS
+      detail::GvlSample sample(location);
+#else
+      detail::GvlSample sample;
+#endif
+      CallbackData data{std::move(callback), ResultType{}, nullptr, sample};
       std::optional<UbfData> ubf_data;
       if(ubf) {
-        ubf_data.emplace(std::move(*ubf), nullptr);
+        ubf_data.emplace(std::move(*ubf), nullptr, sample);
       }
 
       auto callback_wrapper = [](void *RCX_Nonnull arg) -> void * {
         auto &data = *static_cast<CallbackData * RCX_Nonnull>(arg);
+        RCX_PROBE(gvl__released);
+        data.sample.released();
         try {
           if constexpr(std::is_void_v<std::invoke_result_t<F>>) {
             data.callback();
@@ -1480,14 +3019,22 @@ namespace rcx {
         } catch(...) {
           data.exception = std::current_exception();
         }
+        data.sample.reacquiring();
+        RCX_PROBE(gvl__reacquire);
         return reinterpret_cast<void *>(1);  // Non-null to indicate execution
       };
 
       using Ubf = void (*RCX_Nullable)(void *RCX_Nonnull);
       Ubf ubf_wrapper = nullptr;
-      if(ubf_data) {
+      if constexpr(std::is_same_v<U, UbfIo>) {
+        if(ubf_data) {
+          ubf_wrapper = RUBY_UBF_IO;
+          ubf_data.reset();
+        }
+      } else if(ubf_data) {
         ubf_wrapper = [](void *RCX_Nonnull arg) -> void {
           auto &data = *static_cast<UbfData * RCX_Nonnull>(arg);
+          data.sample.unblocked();
           try {
             data.ubf();
           } catch(...) {
@@ -1496,8 +3043,11 @@ namespace rcx {
         };
       }
 
+      RCX_PROBE(gvl__release, static_cast<int>(flags));
       void *result = rb_nogvl(callback_wrapper, &data, ubf_wrapper,
           ubf_data ? std::addressof(*ubf_data) : nullptr, static_cast<int>(flags));
+      sample.acquired(result != nullptr);
+      RCX_PROBE(gvl__acquired, result != nullptr);
 
       // Check for UBF exceptions first. The callback was cancelled with UBF, which then raised.
       if(ubf_data && ubf_data->exception) {
@@ -1527,23 +3077,370 @@ namespace rcx {
     }
 
     template <std::invocable<> F, std::invocable<> U>
-    auto without_gvl(F &&callback, U ubf, ReleaseFlags flags) noexcept(noexcept(callback(), ubf()))
-        -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
-            std::optional<std::invoke_result_t<F>>> {
-      return without_gvl(
-          std::forward<F>(callback), std::optional<std::remove_cvref_t<U>>(std::move(ubf)), flags);
+    auto without_gvl(F &&callback, U ubf, ReleaseFlags flags RCX_LOCATION_PARAM) noexcept(
+        noexcept(callback(), ubf())) -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>,
+        bool, std::optional<std::invoke_result_t<F>>> {
+      return without_gvl(std::forward<F>(callback),
+          std::optional<std::remove_cvref_t<U>>(std::move(ubf)), flags RCX_LOCATION_ARG);
     }
 
     template <std::invocable<> F>
-    auto without_gvl(F &&callback, ReleaseFlags flags) noexcept(noexcept(callback()))
-        -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
-            std::optional<std::invoke_result_t<F>>> {
+    auto without_gvl(F &&callback, ReleaseFlags flags RCX_LOCATION_DEF) noexcept(
+        noexcept(callback())) -> std::conditional_t<std::is_void_v<std::invoke_result_t<F>>, bool,
+        std::optional<std::invoke_result_t<F>>> {
       using DefaultUbf = void (*)();
-      return without_gvl(std::forward<F>(callback), std::optional<DefaultUbf>(std::nullopt), flags);
+      return without_gvl(std::forward<F>(callback), std::optional<DefaultUbf>(std::nullopt),
+          flags RCX_LOCATION_ARG);
     }
 
     inline void check_interrupts() {
       detail::protect([]() noexcept { ::rb_thread_check_ints(); });
     }
+
+#ifdef RCX_GVL_STATS
+    inline Value stats() {
+      using namespace literals;
+      using Stats = detail::GvlStats;
+
+      auto const new_hash = []() {
+        return detail::unsafe_coerce<Value>(
+            detail::protect([]() noexcept { return ::rb_hash_new(); }));
+      };
+      auto const aset = [](Value hash, Value key, Value value) {
+        detail::protect([&]() noexcept {
+          ::rb_hash_aset(hash.as_VALUE(), key.as_VALUE(), value.as_VALUE());
+        });
+      };
+      auto const seconds = [](std::uint64_t nanoseconds) {
+        return into_Value(static_cast<double>(nanoseconds) / 1e9);
+      };
+
+      auto const sites = new_hash();
+      for(auto const &[name, totals]: Stats::instance().snapshot()) {
+        auto const entry = new_hash();
+        aset(entry, "calls"_sym, into_Value(totals.calls));
+        aset(entry, "cancelled"_sym, into_Value(totals.cancelled));
+        aset(entry, "ubf_calls"_sym, into_Value(totals.ubf_calls));
+        aset(entry, "released_time"_sym, seconds(totals.released_nanoseconds));
+        aset(entry, "reacquire_time"_sym, seconds(totals.reacquire_nanoseconds));
+        aset(sites, String::copy_from(name), entry);
+      }
+
+      auto const result = new_hash();
+      aset(result, "sites"_sym, sites);
+#if HAVE_RB_INTERNAL_THREAD_ADD_EVENT_HOOK
+      auto const [waits, wait_nanoseconds] = Stats::instance().waits();
+      aset(result, "waits"_sym, into_Value(waits));
+      aset(result, "wait_time"_sym, seconds(wait_nanoseconds));
+#endif
+      return result;
+    }
+#endif
+  }
+
+#if defined(RCX_URING) && defined(RCX_IO_BUFFER)
+  namespace uring {
+    inline Ring::Ring(unsigned entries): entries_(entries) {
+      if(auto const err = ::io_uring_queue_init(entries, &ring_, 0); err < 0) {
+        throw Exception::new_from_errno("io_uring_queue_init", -err);
+      }
+    }
+
+    inline Ring::~Ring() {
+      ::io_uring_queue_exit(&ring_);
+    }
+
+    inline void Ring::reap(size_t &pending) noexcept {
+      unsigned head;
+      unsigned seen = 0;
+      ::io_uring_cqe *cqe;
+      io_uring_for_each_cqe(&ring_, head, cqe) {
+        // Completions of cancellation requests carry no data.
+        if(auto const result = static_cast<ReadResult *>(::io_uring_cqe_get_data(cqe))) {
+          *result = cqe->res < 0 ? ReadResult{.error = -cqe->res}
+                                 : ReadResult{.bytes = static_cast<size_t>(cqe->res)};
+          --pending;
+        }
+        ++seen;
+      }
+      ::io_uring_cq_advance(&ring_, seen);
+    }
+
+    // Submits the prepared requests and waits for all of them. Returns zero or a negative errno,
+    // which is -EINTR if a signal, such as the one sent by RUBY_UBF_IO, interrupted the wait.
+    inline int Ring::wait(size_t &pending) noexcept {
+      while(pending > 0) {
+        auto const err = ::io_uring_submit_and_wait(&ring_, 1);
+        if(err < 0 && err != -EAGAIN && err != -EBUSY) {
+          return err;
+        }
+        reap(pending);
+      }
+      return 0;
+    }
+
+    // Cancels the reads in flight and waits for all of them. Returns zero or a negative errno.
+    inline int Ring::cancel(std::span<ReadResult> results, size_t &pending) noexcept {
+      reap(pending);
+      for(auto &result: results) {
+        if(result.error != EINPROGRESS) {
+          continue;
+        }
+        auto sqe = ::io_uring_get_sqe(&ring_);
+        if(!sqe) {
+          ::io_uring_submit(&ring_);
+          if(!(sqe = ::io_uring_get_sqe(&ring_))) {
+            return -EBUSY;
+          }
+        }
+        ::io_uring_prep_cancel(sqe, &result, 0);
+        ::io_uring_sqe_set_data(sqe, nullptr);
+      }
+      while(true) {
+        if(auto const err = wait(pending); err != -EINTR) {
+          return err;
+        }
+      }
+    }
+
+    inline std::vector<ReadResult> Ring::read(
+        std::span<ReadRequest const> requests RCX_LOCATION_DEF) {
+      if(poisoned_) {
+        throw Exception::format(builtin::IOError, "io_uring is unusable after a failed read");
+      }
+
+      struct Op {
+        int fd;
+        std::span<std::byte> bytes;
+        size_t offset;
+      };
+
+      // Keeps the buffers alive even if the caller drops them while the GVL is released.
+      auto const buffers = Array::new_array(static_cast<long>(requests.size()));
+      std::vector<std::unique_lock<IOBuffer const>> locks;
+      locks.reserve(requests.size());
+      std::vector<Op> ops;
+      ops.reserve(requests.size());
+      for(auto const &request: requests) {
+        request.io.check_readable();
+        buffers.push_back(request.buffer);
+        locks.emplace_back(request.buffer);
+        ops.push_back({request.io.descriptor(), request.buffer.bytes(), request.offset});
+      }
+
+      // A result keeps EINPROGRESS until its read completes.
+      std::vector<ReadResult> results(requests.size(), ReadResult{.error = EINPROGRESS});
+      for(size_t begin = 0; begin < ops.size();) {
+        auto const batch =
+            std::span(ops).subspan(begin, std::min<size_t>(ops.size() - begin, entries_));
+        auto const batch_results = std::span(results).subspan(begin, batch.size());
+        for(size_t i = 0; i < batch.size(); ++i) {
+          auto const &op = batch[i];
+          // The submission queue is empty, since every batch is waited for.
+          auto *const sqe = ::io_uring_get_sqe(&ring_);
+          rcx_assert(sqe);
+          ::io_uring_prep_read(sqe, op.fd, op.bytes.data(),
+              static_cast<unsigned>(std::min<size_t>(op.bytes.size(), UINT_MAX)), op.offset);
+          ::io_uring_sqe_set_data(sqe, &batch_results[i]);
+        }
+        size_t pending = batch.size();
+
+        auto const abandon = [&] {
+          auto const err = gvl::without_gvl(
+              [&]() noexcept { return cancel(batch_results, pending); },
+              gvl::ReleaseFlags::None RCX_LOCATION_ARG);
+          if(*err != 0) {
+            // The kernel may still write into the buffers and the results.
+            poisoned_ = true;
+            for(auto &lock: locks) {
+              lock.release();
+            }
+            detail::protect(
+                [&]() noexcept { ::rb_gc_register_mark_object(buffers.as_VALUE()); });
+            static_cast<void>(new auto(std::move(results)));  // let it leak
+          }
+        };
+
+        while(true) {
+          auto const err = gvl::without_gvl([&]() noexcept { return wait(pending); },
+              std::optional(gvl::ubf_io), gvl::ReleaseFlags::IntrFail RCX_LOCATION_ARG);
+          if(err && *err == 0) {
+            break;
+          }
+          if(!err || *err == -EINTR) {
+            try {
+              gvl::check_interrupts();
+            } catch(...) {
+              abandon();
+              throw;
+            }
+            continue;
+          }
+          abandon();
+          throw Exception::new_from_errno("io_uring_submit_and_wait", -*err);
+        }
+        begin += batch.size();
+      }
+
+      VALUE guard = buffers.as_VALUE();
+      RB_GC_GUARD(guard);
+      return results;
+    }
+
+    inline std::vector<ReadResult> read(
+        std::span<ReadRequest const> requests RCX_LOCATION_DEF) {
+      thread_local Ring ring;
+      return ring.read(requests RCX_LOCATION_ARG);
+    }
+
+    inline Array read(Array requests RCX_LOCATION_DEF) {
+      std::vector<ReadRequest> batch;
+      batch.reserve(requests.size());
+      for(size_t i = 0; i < requests.size(); ++i) {
+        auto const request = requests.at<Array>(i);
+        batch.push_back({request.at<IO>(0), request.at<IOBuffer>(1), request.at<size_t>(2)});
+      }
+
+      auto const results = read(batch RCX_LOCATION_ARG);
+      auto const array = Array::new_array(static_cast<long>(results.size()));
+      for(auto const &result: results) {
+        if(result.error == 0) {
+          array.push_back(result.bytes);
+        } else {
+          array.push_back(Exception::new_from_errno("read", result.error));
+        }
+      }
+      return array;
+    }
+  }
+#endif
+
+  namespace scan {
+    namespace detail {
+      inline void find_all_scalar(std::span<std::byte const> bytes, size_t from,
+          std::byte delimiter, std::vector<size_t> &offsets) {
+        auto const *const begin = bytes.data();
+        auto const *const end = begin + bytes.size();
+        for(auto const *p = begin + from; p < end;) {
+          auto const *const hit = static_cast<std::byte const *>(
+              std::memchr(p, static_cast<int>(delimiter), static_cast<size_t>(end - p)));
+          if(!hit) {
+            break;
+          }
+          offsets.push_back(static_cast<size_t>(hit - begin));
+          p = hit + 1;
+        }
+      }
+
+      /**
+       * Appends the offsets of the set bits of a mask with one bit per byte.
+       */
+      template <std::unsigned_integral M>
+      inline void push_mask(size_t base, M mask, std::vector<size_t> &offsets) {
+        for(; mask; mask &= mask - 1) {
+          offsets.push_back(base + static_cast<size_t>(std::countr_zero(mask)));
+        }
+      }
+
+#ifdef RCX_SCAN_X86_64
+      inline void find_all_sse2(
+          std::span<std::byte const> bytes, std::byte delimiter, std::vector<size_t> &offsets) {
+        auto const needle = _mm_set1_epi8(static_cast<char>(delimiter));
+        size_t i = 0;
+        for(; i + 16 <= bytes.size(); i += 16) {
+          auto const chunk = _mm_loadu_si128(reinterpret_cast<__m128i const *>(bytes.data() + i));
+          push_mask(i, static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle))),
+              offsets);
+        }
+        find_all_scalar(bytes, i, delimiter, offsets);
+      }
+
+      __attribute__((target("avx2"))) inline void find_all_avx2(
+          std::span<std::byte const> bytes, std::byte delimiter, std::vector<size_t> &offsets) {
+        auto const needle = _mm256_set1_epi8(static_cast<char>(delimiter));
+        size_t i = 0;
+        for(; i + 32 <= bytes.size(); i += 32) {
+          auto const chunk =
+              _mm256_loadu_si256(reinterpret_cast<__m256i const *>(bytes.data() + i));
+          push_mask(i,
+              static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle))),
+              offsets);
+        }
+        find_all_scalar(bytes, i, delimiter, offsets);
+      }
+#endif
+
+#ifdef RCX_SCAN_NEON
+      inline void find_all_neon(
+          std::span<std::byte const> bytes, std::byte delimiter, std::vector<size_t> &offsets) {
+        auto const needle = vdupq_n_u8(static_cast<std::uint8_t>(delimiter));
+        size_t i = 0;
+        for(; i + 16 <= bytes.size(); i += 16) {
+          auto const chunk = vld1q_u8(reinterpret_cast<std::uint8_t const *>(bytes.data() + i));
+          auto const eq = vreinterpretq_u16_u8(vceqq_u8(chunk, needle));
+          // Narrow to 4 bits per byte, and keep one of them.
+          auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(eq, 4)), 0);
+          for(mask &= 0x8888888888888888; mask; mask &= mask - 1) {
+            offsets.push_back(i + static_cast<size_t>(std::countr_zero(mask)) / 4);
+          }
+        }
+        find_all_scalar(bytes, i, delimiter, offsets);
+      }
+#endif
+    }
+
+    inline void find_all(
+        std::span<std::byte const> bytes, std::byte delimiter, std::vector<size_t> &offsets) {
+#if defined(RCX_SCAN_X86_64)
+      static auto const impl =
+          __builtin_cpu_supports("avx2") ? &detail::find_all_avx2 : &detail::find_all_sse2;
+      impl(bytes, delimiter, offsets);
+#elif defined(RCX_SCAN_NEON)
+      detail::find_all_neon(bytes, delimiter, offsets);
+#else
+      detail::find_all_scalar(bytes, 0, delimiter, offsets);
+#endif
+    }
+
+    inline std::vector<size_t> find_all(std::span<std::byte const> bytes, std::byte delimiter) {
+      std::vector<size_t> offsets;
+      find_all(bytes, delimiter, offsets);
+      return offsets;
+    }
+
+    inline Array split(String string, char delimiter RCX_LOCATION_DEF) {
+      // Releasing the GVL costs more than scanning small strings.
+      constexpr size_t release_threshold = 64 * 1024;
+
+      std::vector<size_t> offsets;
+      {
+        PinnedBytes const pinned(string);
+        auto const bytes = pinned.bytes();
+        auto const scan = [&]() { find_all(bytes, static_cast<std::byte>(delimiter), offsets); };
+        if(bytes.size() < release_threshold ||
+            !gvl::without_gvl(scan, gvl::ReleaseFlags::IntrFail RCX_LOCATION_ARG)) {
+          scan();
+        }
+      }
+
+      std::vector<std::pair<size_t, size_t>> ranges;
+      ranges.reserve(offsets.size() + 1);
+      size_t begin = 0;
+      for(auto const offset: offsets) {
+        ranges.emplace_back(begin, offset - begin);
+        begin = offset + 1;
+      }
+      if(begin < string.size()) {
+        ranges.emplace_back(begin, string.size() - begin);
+      }
+
+      auto const array = string.subseq(ranges);
+      ::rcx::detail::protect([&]() noexcept {
+        for(long i = 0; i < RARRAY_LEN(array.as_VALUE()); ++i) {
+          ::rb_obj_freeze(RARRAY_AREF(array.as_VALUE(), i));
+        }
+      });
+      return array;
+    }
   }
 }
@@ -17,7 +17,7 @@ module RCX
   module MakeMakefile
     include ::MakeMakefile['C++']
 
-    def setup_rcx(cxx_standard: 'c++20')
+    def setup_rcx(cxx_standard: 'c++20', method_stats: false, gvl_stats: false, usdt: false)
       CXX_STANDARD_FLAGS.fetch(cxx_standard).find do |flag|
         if checking_for("whether #{flag} is accepted as CXXFLAGS") { try_cflags(flag) }
           $CXXFLAGS << " " << flag
@@ -62,6 +62,30 @@ CXX
       end
 
       have_func('ruby_thread_has_gvl_p', 'ruby/thread.h')
+      have_func('rb_internal_thread_add_event_hook', 'ruby/thread.h')
+
+      if have_header('sys/mman.h')
+        have_func('madvise', 'sys/mman.h')
+      end
+
+      have_func('copy_file_range', 'unistd.h')
+      if have_header('sys/sendfile.h')
+        have_func('sendfile', 'sys/sendfile.h')
+      end
+
+      if have_header('liburing.h') && have_library('uring', 'io_uring_queue_init', 'liburing.h')
+        $defs.push("-DRCX_URING=1")
+      end
+
+      $defs.push("-DRCX_METHOD_STATS=1") if method_stats
+      $defs.push("-DRCX_GVL_STATS=1") if gvl_stats
+
+      if usdt
+        unless have_header('sys/sdt.h')
+          raise "sys/sdt.h was not found"
+        end
+        $defs.push("-DRCX_USDT=1")
+      end
     end
 
     def configuration(...)
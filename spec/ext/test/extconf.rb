@@ -1,7 +1,13 @@
 # SPDX-License-Identifier: BSL-1.0
 # SPDX-FileCopyrightText: Copyright 2024-2025 Kasumi Hanazuki <kasumi@rollingapple.net>
 
-require 'rcx/mkmf/c++20'
+require 'rcx/mkmf'
+include RCX::MakeMakefile
+# Set RCX_SPEC_STATS=0 to test the default configuration without the statistics.
+stats = ENV.fetch('RCX_SPEC_STATS', '1') != '0'
+# Set RCX_SPEC_USDT=1 to add the USDT probes, which requires sys/sdt.h.
+usdt = ENV.fetch('RCX_SPEC_USDT', '0') != '0'
+setup_rcx(cxx_standard: 'c++20', method_stats: stats, gvl_stats: stats, usdt:)
 
 %w[
   -g3
@@ -3,11 +3,15 @@
 #include "main.hpp"
 
 #include <cerrno>
+#include <chrono>
 #include <cmath>
 #include <limits>
 #include <mutex>
+#include <ranges>
+#include <source_location>
 #include <span>
 #include <stdexcept>
+#include <thread>
 
 #include <rcx/rcx.hpp>
 
@@ -116,6 +120,258 @@ Value Test::test_string(Value self) {
     self.send("assert_kind_of", rcx::builtin::String, flit);
     self.send("assert_equal", test, flit);
     self.send("assert_send", "test"_fstr, "frozen?"_sym);
+    self.send("assert_same", "test"_fstr, "test"_fstr);
+    self.send("assert_same", u8"テスト"_fstr, u8"テスト"_fstr);
+  }
+
+  {
+    auto slit = "test"_sstr;
+    self.send("assert_kind_of", rcx::builtin::String, slit);
+    self.send("assert_equal", test, slit);
+    self.send("assert_not_predicate", slit, "frozen?"_sym);
+    self.send("assert_equal", u8test, u8"テスト"_sstr);
+
+    slit.send("<<", "!"_str);
+    self.send("assert_equal", "test!"_str, slit);
+    self.send("assert_equal", test, "test"_sstr);
+  }
+
+  {
+    static constexpr std::string_view sv = "test";
+    auto s = String::new_static(sv);
+    self.send("assert_equal", test, s);
+    self.send("assert_not_predicate", s, "frozen?"_sym);
+  }
+
+  {
+    auto str = "pinned"_str;
+    {
+      rcx::PinnedBytes const pinned(str);
+      ASSERT_EQ(6u, pinned.bytes().size());
+      ASSERT_RAISE([&] { str.send("<<", "!"_str); });
+      ASSERT_RAISE([&] { rcx::PinnedBytes{str}; });
+
+      auto const sum = rcx::gvl::without_gvl(
+          [bytes = pinned.bytes()] {
+            int sum = 0;
+            for(auto b : bytes) {
+              sum += std::to_integer<int>(b);
+            }
+            return sum;
+          },
+          rcx::gvl::ReleaseFlags::None);
+      ASSERT_EQ(int{'p' + 'i' + 'n' + 'n' + 'e' + 'd'}, *sum);
+    }
+    str.send("<<", "!"_str);
+    self.send("assert_equal", "pinned!"_str, str);
+  }
+
+  {
+    // Frozen strings are not locked, so they can be pinned more than once.
+    auto const str = "pinned"_fstr;
+    rcx::PinnedBytes const pinned(str);
+    rcx::PinnedBytes const again(str);
+    ASSERT_EQ(pinned.bytes().data(), again.bytes().data());
+  }
+
+  {
+    auto const source = self.send<String>("eval"_sym, "'0123456789' * 10"_str);
+    auto const piece = source.subseq(10, 50);
+    ASSERT_EQ(50, piece.size());
+    ASSERT_EQ('0', piece.cdata()[0]);
+    ASSERT_EQ(0, source.subseq(100, 0).size());
+    ASSERT_RAISE([&] { source.subseq(100, 1); });
+    ASSERT_RAISE([&] { source.subseq(1, SIZE_MAX); });
+
+    piece.send("setbyte", 0, int{'x'});
+    ASSERT_EQ('x', piece.cdata()[0]);
+    ASSERT_EQ('0', source.cdata()[10]);
+
+    // Only a substring extending to the end shares the storage.
+    auto const large = self.send<String>("eval"_sym, "require 'objspace'; 'x' * 10000"_str);
+    auto const memsize = [&](String str) {
+      return self.send<Value>("eval"_sym, "ObjectSpace"_str).send<size_t>("memsize_of", str);
+    };
+    self.send("assert_send", memsize(large.subseq(100, 9900)), "<"_sym, 1000);
+    self.send("assert_send", memsize(large.subseq(100, 5000)), ">="_sym, 5000);
+
+    std::array<std::pair<size_t, size_t>, 3> const ranges{{{0, 1}, {95, 5}, {3, 0}}};
+    auto const pieces = source.subseq(ranges);
+    ASSERT_EQ(3, pieces.size());
+    ASSERT_EQ("0"sv, std::string_view(pieces.at<String>(0)));
+    ASSERT_EQ("56789"sv, std::string_view(pieces.at<String>(1)));
+    ASSERT_EQ(""sv, std::string_view(pieces.at<String>(2)));
+
+    std::array<std::pair<size_t, size_t>, 2> const invalid{{{0, 1}, {99, 2}}};
+    ASSERT_RAISE([&] { source.subseq(invalid); });
+  }
+
+  return Value::qtrue;
+}
+
+Value Test::test_symbol(Value self) {
+  {
+    std::string const name = "dynamic_name";
+    Symbol const sym1(name);
+    Symbol const sym2(std::string_view(name).substr(0, 7));
+    self.send("assert_equal", "dynamic_name"_sym, sym1);
+    self.send("assert_equal", "dynamic"_sym, sym2);
+    ASSERT_EQ(sym1.as_ID(), Symbol(std::string_view(name)).as_ID());
+    ASSERT_EQ(sym1.as_ID(), rb_intern("dynamic_name"));
+  }
+
+  {
+    auto const obj = rcx::builtin::Object.new_instance();
+    std::string const ivar = "@foo";
+    obj.instance_variable_set(ivar, 42);
+    ASSERT_EQ(42, obj.instance_variable_get<int>(ivar));
+    ASSERT_EQ(42, obj.instance_variable_get<int>("@foo"_id));
+  }
+
+  return Value::qtrue;
+}
+
+Value Test::test_enum(Value self) {
+  using namespace rcx::args;
+
+  self.send("assert_equal", "fast"_sym, rcx::into_Value(Mode::Fast));
+  self.send("assert_equal", "small"_sym, rcx::into_Value(Mode::Small));
+  ASSERT_RAISE([&] { rcx::into_Value(Mode::Unnamed); });
+
+  ASSERT(Mode::Balanced == rcx::from_Value<Mode>("balanced"_sym));
+  ASSERT(Mode::Small == rcx::from_Value<Mode>(Symbol(std::string_view("small"))));
+  ASSERT_RAISE([&] { rcx::from_Value<Mode>("slow"_sym); });
+  ASSERT_RAISE([&] { rcx::from_Value<Mode>("fast"_str); });
+
+  auto obj = rcx::builtin::Object.new_instance();
+  obj.define_singleton_method<void>("mode", [](Mode mode) { return mode; }, arg<Mode>);
+  self.send("assert_equal", "balanced"_sym, obj.send("mode", "balanced"_sym));
+  try {
+    obj.send("mode", "slow"_sym);
+    ASSERT(false);
+  } catch(Exception const &e) {
+    self.send("assert_kind_of", rcx::builtin::ArgumentError, e);
+    self.send("assert_equal", "Invalid value :slow; expected one of :fast, :balanced, :small"_str,
+        e.send("message"));
+  }
+
+  {
+    // Invalid dynamic Symbols are not pinned, so they are collected.
+    auto const growth = obj.send<int>("instance_eval"_sym,
+        "before = Symbol.all_symbols.size;"
+        "1000.times { |i| mode(\"rcx_test_invalid_#{i}\".to_sym) rescue nil };"
+        "GC.start; Symbol.all_symbols.size - before"_str);
+    self.send("assert_send", growth, "<"_sym, 100);
+  }
+
+  {
+    auto const low = "rcx_test_level_low"_str.send("to_sym");
+    ASSERT(Level::Low == rcx::from_Value<Level>(low));
+    self.send("eval", "GC.start"_str);
+    self.send("assert_equal", low, rcx::into_Value(Level::Low));
+    ASSERT(Level::High == rcx::from_Value<Level>("rcx_test_level_high"_str.send("to_sym")));
+  }
+
+  return Value::qtrue;
+}
+
+Value Test::test_proc(Value self) {
+  auto const add = self.send<rcx::Proc>("eval", "->(a, b) { a + b }"_str);
+  self.send("assert_equal", 3, add.call(1, 2));
+  ASSERT_EQ(7, add.call<int>(3, 4));
+  self.send("assert_equal", 5,
+      add.call(rcx::Array::new_from({rcx::into_Value(2), rcx::into_Value(3)})));
+
+  auto const constant = self.send<rcx::Proc>("eval", "proc { 42 }"_str);
+  self.send("assert_equal", 42, constant.call());
+
+  auto const with_block = self.send<rcx::Proc>("eval", "proc {|x, &b| b.call(x) }"_str);
+  auto const twice = self.send<rcx::Proc>("eval", "->(x) { x * 2 }"_str);
+  self.send("assert_equal", 20, with_block.call_with_block(twice, 10));
+
+  return Value::qtrue;
+}
+
+namespace {
+  // Single-pass range like a generator.
+  struct Countdown {
+    struct iterator {
+      using difference_type = std::ptrdiff_t;
+      using value_type = int;
+
+      int *n;
+
+      int operator*() const {
+        return *n;
+      }
+      iterator &operator++() {
+        --*n;
+        return *this;
+      }
+      void operator++(int) {
+        ++*this;
+      }
+      bool operator==(std::default_sentinel_t) const {
+        return *n == 0;
+      }
+    };
+
+    int n;
+
+    iterator begin() {
+      return {&n};
+    }
+    std::default_sentinel_t end() {
+      return {};
+    }
+  };
+}
+
+Value Test::test_enumerate(Value self) {
+  auto const cEnumerator = self.send("eval", "Enumerator"_str);
+
+  {
+    auto const e = rcx::into_Value(rcx::Enumerate{std::views::iota(0, 3)});
+    self.send("assert_kind_of", cEnumerator, e);
+    self.send("assert_equal", 3, e.send("size"));
+    self.send("assert_equal", self.send("eval", "[0, 1, 2]"_str), e.send("to_a"));
+    self.send("assert_equal", self.send("eval", "[0, 1, 2]"_str), e.send("to_a"));
+  }
+
+  {
+    auto const e = rcx::into_Value(rcx::Enumerate{std::views::iota(0)});
+    self.send("assert_nil", e.send("size"));
+    self.send("assert_equal", self.send("eval", "[0, 1, 2]"_str), e.send("first", 3));
+    self.send("assert_equal", 1, e.send("next").send("succ"));
+  }
+
+  {
+    static_assert(!std::ranges::forward_range<Countdown>);
+    auto const e = rcx::into_Value(rcx::Enumerate{Countdown{3}});
+    self.send("assert_equal", self.send("eval", "[3, 2, 1]"_str), e.send("to_a"));
+    ASSERT_RAISE([&] { e.send("to_a"); });
+  }
+
+  {
+    auto const e = [] {
+      std::vector<int> values{4, 5, 6};
+      return rcx::into_Value(rcx::Enumerate{std::views::all(std::move(values))});
+    }();
+    self.send("assert_equal", self.send("eval", "[4, 5, 6]"_str), e.send("to_a"));
+  }
+
+  {
+    auto const e = [] {
+      std::vector<String> values;
+      for(int i = 0; i < 3; ++i) {
+        values.push_back(String::copy_from(std::format("owned {}", i)));
+      }
+      return rcx::into_Value(rcx::Enumerate{std::views::all(std::move(values))});
+    }();
+    self.send("eval", "GC.start"_str);
+    self.send("eval", "GC.verify_compaction_references(expand_heap: true, toward: :empty)"_str);
+    self.send("assert_equal", self.send("eval", "['owned 0', 'owned 1', 'owned 2']"_str),
+        e.send("to_a"));
   }
 
   return Value::qtrue;
@@ -322,6 +578,110 @@ Value Test::test_io_buffer([[maybe_unused]] Value self) {
     std::scoped_lock lock(b1, b2);
   }
 
+  {
+    auto const b = IOBuffer::new_internal(100);
+    {
+      rcx::IOBufferGuard const guard(b);
+      ASSERT_EQ(false, b.try_lock());
+      ASSERT_RAISE([&] { rcx::IOBufferGuard{b}; });
+
+      auto const head = guard.bytes(0, 50);
+      auto const tail = guard.bytes(50, 50);
+      rcx::gvl::without_gvl(
+          [&]() noexcept {
+            std::ranges::fill(head, std::byte{1});
+            std::ranges::fill(tail, std::byte{2});
+          },
+          rcx::gvl::ReleaseFlags::None);
+      ASSERT_EQ(std::byte{1}, guard.cbytes()[49]);
+      ASSERT_EQ(std::byte{2}, guard.cbytes(99, 1)[0]);
+      ASSERT_EQ(0, guard.cbytes(100, 0).size());
+
+      auto const out_of_range = [&](size_t offset, size_t length) {
+        try {
+          guard.cbytes(offset, length);
+          return false;
+        } catch(std::out_of_range const &) {
+          return true;
+        }
+      };
+      ASSERT_EQ(true, out_of_range(0, 101));
+      ASSERT_EQ(true, out_of_range(101, 0));
+      ASSERT_EQ(true, out_of_range(1, SIZE_MAX));
+    }
+
+    ASSERT_EQ(true, b.try_lock());
+    {
+      rcx::IOBufferGuard const guard(b, std::adopt_lock);
+      ASSERT_EQ(100, guard.bytes().size());
+    }
+    ASSERT_EQ(true, b.try_lock());
+    b.unlock();
+    b.free();
+  }
+
+  {
+    rcx::IOBufferPool pool(4096, 65536, std::chrono::milliseconds(50));
+    std::optional<IOBuffer> returned;
+    {
+      auto const lease = pool.acquire(100);
+      ASSERT_EQ(4096, lease.buffer().cbytes().size());
+      lease.buffer().bytes()[0] = std::byte{42};
+      returned = lease.buffer();
+    }
+    ASSERT_EQ(4096, pool.idle_bytes());
+    // The returned storage has been taken away from the object.
+    ASSERT_RAISE([&] { returned->cbytes(); });
+    {
+      auto lease = pool.acquire(4096);
+      ASSERT_EQ(0, pool.idle_bytes());
+      ASSERT_EQ(std::byte{42}, lease.buffer().cbytes()[0]);
+      auto const other = pool.acquire(5000);
+      ASSERT_EQ(8192, other.buffer().cbytes().size());
+      auto const large = pool.acquire(100000);
+      ASSERT_EQ(100000, large.buffer().cbytes().size());
+
+      auto moved = std::move(lease);
+      moved.release();
+      ASSERT_EQ(4096, pool.idle_bytes());
+    }
+    ASSERT_EQ(4096 + 8192, pool.idle_bytes());
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    pool.trim();
+    ASSERT_EQ(0, pool.idle_bytes());
+  }
+
+  {
+    // Destroyed after the VM at exit, holding an idle buffer.
+    static rcx::IOBufferPool pool(4096, 4096, std::chrono::hours(1));
+    pool.acquire(100);
+    ASSERT_EQ(4096, pool.idle_bytes());
+  }
+
+  {
+    auto const file = self.send<IO>("eval"_sym,
+        "require 'tempfile'; Tempfile.create('rcx').tap { _1.write('hello world'); _1.flush }"_str);
+
+    auto const whole = IOBuffer::map_file(file);
+    ASSERT_EQ(11, whole.cbytes().size());
+    ASSERT_EQ(std::byte{'h'}, whole.cbytes()[0]);
+    ASSERT_RAISE([&] { whole.bytes(); });
+
+    using enum IOBuffer::MapFlags;
+    auto const part = IOBuffer::map_file(file, 0, 5, Private | Sequential | WillNeed | HugePage);
+    ASSERT_EQ(5, part.cbytes().size());
+    part.bytes()[0] = std::byte{'j'};
+    ASSERT_EQ(std::byte{'j'}, part.cbytes()[0]);
+    ASSERT_EQ(std::byte{'h'}, whole.cbytes()[0]);
+
+    ASSERT_RAISE([&] { IOBuffer::map_file(file, 4096 * 16); });
+
+    whole.free();
+    part.free();
+    file.send("close");
+    rcx::builtin::File.send("unlink", file.send("path"));
+  }
+
   return Value::qtrue;
 }
 
@@ -355,6 +715,58 @@ Value Test::test_args([[maybe_unused]] Value self) {
 }
 
 Value Test::test_exception(Value self) {
+  {
+    auto const s = "pui"s;
+    auto const exc = rcx::Exception::deferred(rcx::builtin::RangeError, "deferred {} {}", 42, s);
+    self.send("assert_equal", String::copy_from("deferred 42 pui"), String::copy_from(exc.what()));
+    self.send("assert_equal", rcx::builtin::RangeError, exc.exception_class());
+
+    auto const ruby_exc = exc.new_exception();
+    self.send("assert_kind_of", rcx::builtin::RangeError, ruby_exc);
+    self.send("assert_equal", String::copy_from("deferred 42 pui"), ruby_exc.send("message"));
+  }
+
+  {
+    CountedFormat::count = 0;
+    auto const exc = rcx::Exception::deferred(rcx::builtin::RangeError, "{}", CountedFormat{});
+    ASSERT_EQ(0, CountedFormat::count);
+    auto const ruby_exc = exc.new_exception();
+    ASSERT_EQ(1, CountedFormat::count);
+    self.send("assert_equal", String::copy_from("counted"), ruby_exc.send("message"));
+    self.send("assert_kind_of", rcx::builtin::String, ruby_exc.send("message"));
+    auto const marshal = self.send("eval", "Marshal"_str);
+    auto const loaded = marshal.send("load", marshal.send("dump", ruby_exc));
+    self.send("assert_equal", String::copy_from("counted"), loaded.send("message"));
+    ASSERT_EQ(1, CountedFormat::count);
+  }
+
+  {
+    static rcx::Leak<ClassT<Exception>> anonymous;
+    anonymous = self.send<ClassT<Exception>>("eval"_sym, "Class.new(IndexError)"_str);
+    auto const exc = rcx::Exception::deferred(*anonymous, "anonymous");
+    self.send("eval", "GC.start"_str);
+    self.send("eval", "GC.verify_compaction_references(expand_heap: true, toward: :empty)"_str);
+    auto const ruby_exc = exc.new_exception();
+    self.send("assert_kind_of", rcx::builtin::IndexError, ruby_exc);
+    self.send("assert_equal", String::copy_from("anonymous"), ruby_exc.send("message"));
+  }
+
+  {
+    // The first exception of a class is created without the GVL.
+    try {
+      rcx::gvl::without_gvl(
+          [] {
+            throw rcx::Exception::deferred(rcx::builtin::FloatDomainError, "without {}", "gvl");
+          },
+          rcx::gvl::ReleaseFlags::None);
+      ASSERT(false);
+    } catch(rcx::DeferredException const &e) {
+      self.send("assert_equal", rcx::builtin::FloatDomainError, e.exception_class());
+      self.send(
+          "assert_equal", String::copy_from("without gvl"), e.new_exception().send("message"));
+    }
+  }
+
   {
     auto exc = rcx::Exception::new_from_errno("test message", EAGAIN);
     self.send("assert_kind_of", rcx::builtin::SystemCallError, exc);
@@ -394,6 +806,113 @@ Value Test::test_io(Value self) {
     ASSERT_RAISE([&] { io.check_writable(); });
   }
 
+  {
+    using enum IO::Events;
+    auto const pipe = self.send<Array>("eval"_sym, "IO.pipe"_str);
+    auto const reader = pipe.at<IO>(0);
+    auto const writer = pipe.at<IO>(1);
+    ASSERT_EQ(Writable, writer.wait(Writable, std::chrono::milliseconds(0)));
+    ASSERT_EQ(IO::Events{}, reader.wait(Readable | Priority, std::chrono::milliseconds(1)));
+    writer.send("write", "x"_str);
+    ASSERT_EQ(Readable, reader.wait(Readable) & Readable);
+    reader.send("close");
+    ASSERT_RAISE([&] { reader.wait(Readable); });
+    writer.send("close");
+  }
+
+#ifdef RUBY_IO_TIMEOUT_DEFAULT
+  {
+    // Writing to a full pipe times out with IO#timeout.
+    auto const pipe = self.send<Array>("eval"_sym, "IO.pipe"_str);
+    auto const writer = pipe.at<IO>(1);
+    writer.send("timeout=", 0.01);
+    auto const big = self.send<String>("eval"_sym, "'x' * (1 << 20)"_str);
+    try {
+      writer.writev(std::array{big});
+      ASSERT(false);
+    } catch(Exception const &e) {
+      self.send("assert_kind_of", rcx::builtin::IOTimeoutError, e);
+    }
+    pipe.at<IO>(0).send("close");
+    writer.send("close");
+  }
+#endif
+
+  {
+    auto const file = self.send<IO>("eval"_sym,
+        "require 'tempfile'; Tempfile.create('rcx').tap { _1.write('hello world'); _1.flush }"_str);
+
+    auto const buffer = IOBuffer::new_internal(5);
+    ASSERT_EQ(5, file.pread_into(buffer, 6));
+    ASSERT_EQ(std::byte{'w'}, buffer.cbytes()[0]);
+    ASSERT_EQ(std::byte{'d'}, buffer.cbytes()[4]);
+    ASSERT_EQ(2, file.pread_into(buffer, 9));
+    ASSERT_EQ(0, file.pread_into(buffer, 100));
+
+    std::ranges::fill(buffer.bytes(), std::byte{'!'});
+    ASSERT_EQ(5, file.pwrite_from(buffer, 8));
+    ASSERT_EQ("hello wo!!!!!"sv,
+        std::string_view(rcx::builtin::File.send<String>("read"_sym, file.send("path"))));
+
+    buffer.free();
+    file.send("close");
+    rcx::builtin::File.send("unlink", file.send("path"));
+  }
+
+  {
+    auto const file = self.send<IO>(
+        "eval"_sym, "require 'tempfile'; Tempfile.create('rcx').tap { _1.write('>') }"_str);
+
+    auto const crlf = "\r\n"_fstr;
+    std::array<String, 5> const strings{"a: 1"_str, crlf, ""_str, "b: 2"_str, crlf};
+    ASSERT_EQ(12, file.writev(strings));
+
+    auto const many = self.send<Array>("eval"_sym, "['x'] * 300 + ['y' * 10000]"_str);
+    ASSERT_EQ(10300, file.writev(many));
+    ASSERT_RAISE([&] { file.writev(Array::new_from({Value::qnil})); });
+
+    // More distinct empty Strings than fit in a batch.
+    auto const empties = self.send<Array>("eval"_sym, "Array.new(600) { +'' } + ['z']"_str);
+    ASSERT_EQ(1, file.writev(empties));
+
+    auto const content = rcx::builtin::File.send<String>("read"_sym, file.send("path"));
+    ASSERT_EQ(10314, content.size());
+    ASSERT_EQ(">a: 1\r\nb: 2\r\nxx"sv, std::string_view(content).substr(0, 15));
+    ASSERT_EQ("yz"sv, std::string_view(content).substr(content.size() - 2));
+
+    file.send("close");
+    rcx::builtin::File.send("unlink", file.send("path"));
+  }
+
+  {
+    auto const from = self.send<IO>("eval"_sym,
+        "require 'tempfile'; Tempfile.create('rcx').tap { _1.write('hello world'); _1.flush }"_str);
+    auto const to = self.send<IO>("eval"_sym, "Tempfile.create('rcx')"_str);
+    to.send("write", "> "_str);
+    ASSERT_EQ(5, IO::copy_range(from, to, 6, 5));
+    ASSERT_EQ(11, IO::copy_range(from, to, 0, 100));
+    ASSERT_EQ("> worldhello world"sv,
+        std::string_view(rcx::builtin::File.send<String>("read"_sym, to.send("path"))));
+
+    // Appending falls back to read and write.
+    auto const append = rcx::builtin::File.send<IO>("open"_sym, to.send("path"), "a"_str);
+    ASSERT_EQ(5, IO::copy_range(from, append, 0, 5));
+    append.send("close");
+    ASSERT_EQ("> worldhello worldhello"sv,
+        std::string_view(rcx::builtin::File.send<String>("read"_sym, to.send("path"))));
+
+    auto const pipe = self.send<Array>("eval"_sym, "IO.pipe"_str);
+    ASSERT_EQ(11, IO::copy_range(from, pipe.at<IO>(1), 0, 11));
+    pipe.at<IO>(1).send("close");
+    ASSERT_EQ("hello world"sv, std::string_view(pipe.at<IO>(0).send<String>("read")));
+
+    for(auto const io: {from, to, pipe.at<IO>(0)}) {
+      io.send("close");
+    }
+    rcx::builtin::File.send("unlink", from.send("path"));
+    rcx::builtin::File.send("unlink", to.send("path"));
+  }
+
   return Value::qtrue;
 }
 
@@ -424,6 +943,22 @@ void Base::cxx_exception_unknown() const {
   throw 42;
 }
 
+void Base::cxx_exception_mapped() const {
+  throw MappedError{"pui"};
+}
+
+void Base::cxx_exception_mapped_non_std() const {
+  throw MappedNonStdError{};
+}
+
+void Base::cxx_exception_mapped_arity() const {
+  throw MappedArityError{"pui"};
+}
+
+void Base::cxx_exception_deferred(int n, std::string_view s) const {
+  throw rcx::Exception::deferred(rcx::builtin::ArgumentError, "deferred {} {}", n, s);
+}
+
 void Base::ruby_exception(Exception e) const {
   throw e;
 }
@@ -444,6 +979,18 @@ Value Base::with_block_opt(Value x, std::optional<Proc> block) const {
   }
 }
 
+Value Base::with_yield(Value x, rcx::Yielder block) const {
+  return block.yield(x, x);
+}
+
+Value Base::with_yield_opt(Value x, std::optional<rcx::Yielder> block) const {
+  if(block) {
+    return block->to_proc().call(rcx::Array::new_from({x}));
+  } else {
+    return x;
+  }
+}
+
 Derived::Derived(String string): Base(string) {
 }
 
@@ -545,6 +1092,135 @@ Value Test::test_gvl(Value self) {
   return Value::qtrue;
 }
 
+#ifdef RCX_GVL_STATS
+Value Test::test_gvl_stats(Value self) {
+  auto const site = std::source_location::current();
+  bool const executed = rcx::gvl::without_gvl(
+      []() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); },
+      rcx::gvl::ReleaseFlags::None, site);
+  self.send("assert", executed);
+
+  auto const stats = rcx::gvl::stats();
+  auto const entry = stats.send("fetch", "sites"_sym)
+                         .send("fetch", String::copy_from(
+                                            std::format("{}:{}", site.file_name(), site.line())));
+  self.send("assert_equal", 1, entry.send("fetch", "calls"_sym));
+  self.send("assert_equal", 0, entry.send("fetch", "cancelled"_sym));
+  self.send("assert_equal", 0, entry.send("fetch", "ubf_calls"_sym));
+  self.send("assert_send", entry.send("fetch", "released_time"_sym), ">="_sym, 0.002);
+  self.send("assert_send", entry.send("fetch", "reacquire_time"_sym), ">="_sym, 0.0);
+  self.send("assert_send", stats.send("fetch", "waits"_sym), ">="_sym, 0);
+
+  {
+    // The IO helpers report the statistics under the line of their caller.
+    auto const file = self.send<IO>("eval"_sym, "File.open(File::NULL, 'w')"_str);
+    std::array<String, 1> const strings{"x"_str};
+    auto const line = __LINE__ + 1;
+    ASSERT_EQ(1, file.writev(strings));
+    auto const sites = rcx::gvl::stats().send("fetch", "sites"_sym);
+    self.send("assert_equal", 1,
+        sites.send("fetch", String::copy_from(std::format("{}:{}", __FILE__, line)))
+            .send("fetch", "calls"_sym));
+    file.send("close");
+  }
+
+  return Value::qtrue;
+}
+#endif
+
+Value Test::test_scan(Value self) {
+  {
+    // Cover the SIMD loops and the scalar tails.
+    std::vector<std::byte> bytes(1000);
+    for(size_t i = 0; i < bytes.size(); ++i) {
+      bytes[i] = std::byte(i * 7919 % 13 == 0 ? ',' : 'a');
+    }
+    for(size_t size: {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000}) {
+      auto const view = std::span<std::byte const>(bytes).first(size);
+      std::vector<size_t> expected;
+      for(size_t i = 0; i < size; ++i) {
+        if(view[i] == std::byte{','}) {
+          expected.push_back(i);
+        }
+      }
+      ASSERT_EQ(true, expected == rcx::scan::find_all(view, std::byte{','}));
+    }
+  }
+
+  {
+    auto const lines = rcx::scan::split("a\n\nbc\n"_str);
+    ASSERT_EQ(3, lines.size());
+    ASSERT_EQ("a"sv, std::string_view(lines.at<String>(0)));
+    ASSERT_EQ(""sv, std::string_view(lines.at<String>(1)));
+    ASSERT_EQ("bc"sv, std::string_view(lines.at<String>(2)));
+    self.send("assert_send", lines.at<String>(0), "frozen?"_sym);
+    ASSERT_EQ(2, rcx::scan::split("a,b"_str, ',').size());
+    ASSERT_EQ(0, rcx::scan::split(""_str).size());
+  }
+
+  {
+    auto const large = self.send<String>("eval"_sym, "(('x' * 99) + \"\\n\") * 1000"_str);
+    auto const lines = rcx::scan::split(large);
+    ASSERT_EQ(1000, lines.size());
+    ASSERT_EQ(99, lines.at<String>(999).size());
+  }
+
+  {
+    auto const memsize = [&](String str) {
+      return self.send<Value>("eval"_sym, "require 'objspace'; ObjectSpace"_str)
+          .send<size_t>("memsize_of", str);
+    };
+    auto const source = self.send<String>("eval"_sym, "'x' * 5000 + \"\\n\" + 'y' * 5000"_str);
+    auto const lines = rcx::scan::split(source);
+    ASSERT_EQ(2, lines.size());
+    // Only the last substring, which extends to the end, shares the buffer.
+    self.send("assert_send", memsize(lines.at<String>(0)), ">="_sym, 5000);
+    self.send("assert_send", memsize(lines.at<String>(1)), "<"_sym, 1000);
+  }
+
+  {
+    auto const buffer = IOBuffer::new_internal(64);
+    rcx::IOBufferGuard const guard(buffer);
+    std::ranges::fill(guard.bytes(), std::byte{' '});
+    guard.bytes()[40] = std::byte{'\n'};
+    auto const offsets = rcx::scan::find_all(guard.cbytes(), std::byte{'\n'});
+    ASSERT_EQ(1, offsets.size());
+    ASSERT_EQ(40, offsets[0]);
+  }
+
+  return Value::qtrue;
+}
+
+#ifdef RCX_URING
+Value Test::test_uring(Value self) {
+  auto const file = self.send<IO>("eval"_sym,
+      "require 'tempfile'; Tempfile.create('rcx').tap { _1.write('hello world'); _1.flush }"_str);
+  auto const hello = IOBuffer::new_internal(5);
+  auto const world = IOBuffer::new_internal(8);
+
+  std::array const requests{
+      rcx::uring::ReadRequest{file, hello, 0}, rcx::uring::ReadRequest{file, world, 6}};
+  auto const results = rcx::uring::read(requests);
+  ASSERT_EQ(5, results[0].bytes);
+  ASSERT_EQ(0, results[0].error);
+  ASSERT_EQ(5, results[1].bytes);
+  ASSERT_EQ(std::byte{'h'}, hello.cbytes()[0]);
+  ASSERT_EQ(std::byte{'w'}, world.cbytes()[0]);
+
+  auto const array = rcx::uring::read(
+      Array::new_from({Array::new_from({file, hello, rcx::convert::into_Value(6)})}));
+  ASSERT_EQ(5, array.template at<size_t>(0));
+  ASSERT_EQ(std::byte{'w'}, hello.cbytes()[0]);
+
+  hello.free();
+  world.free();
+  file.send("close");
+  rcx::builtin::File.send("unlink", file.send("path"));
+
+  return Value::qtrue;
+}
+#endif
+
 std::tuple<Associated const &, Associated const &> Associated::swap(
     Value, std::tuple<Associated const &, Associated const &> arr) {
   return {std::ref(std::get<1>(arr)), std::ref(std::get<0>(arr))};
@@ -560,6 +1236,10 @@ extern "C" void Init_test() {
                    .define_method("test_nil", &Test::test_nil)
                    .define_method("test_primitive", &Test::test_primitive)
                    .define_method("test_string", &Test::test_string)
+                   .define_method("test_symbol", &Test::test_symbol)
+                   .define_method("test_enum", &Test::test_enum)
+                   .define_method("test_proc", &Test::test_proc)
+                   .define_method("test_enumerate", &Test::test_enumerate)
                    .define_method("test_class", &Test::test_class)
                    .define_method("test_ivar", &Test::test_ivar)
                    .define_method("test_const", &Test::test_const)
@@ -574,7 +1254,37 @@ extern "C" void Init_test() {
                    .define_method("test_exception", &Test::test_exception)
                    .define_method("test_io", &Test::test_io)
                    .define_method("test_optional", &Test::test_optional)
-                   .define_method("test_gvl", &Test::test_gvl);
+                   .define_method("test_gvl", &Test::test_gvl)
+                   .define_method("test_scan", &Test::test_scan);
+  mTest.define_singleton_method<void>(
+      "writev", [](IO io, Array strings) { return io.writev(strings); }, arg<IO>, arg<Array>);
+  mTest.define_singleton_method<void>(
+      "split", [](String string) { return rcx::scan::split(string); }, arg<String>);
+  mTest.define_singleton_method<void>(
+      "pread_into",
+      [](IO io, IOBuffer buffer, size_t offset) { return io.pread_into(buffer, offset); },
+      arg<IO>, arg<IOBuffer>, arg<size_t>);
+  mTest.define_singleton_method<void>(
+      "pwrite_from",
+      [](IO io, IOBuffer buffer, size_t offset) { return io.pwrite_from(buffer, offset); },
+      arg<IO>, arg<IOBuffer>, arg<size_t>);
+  mTest.define_singleton_method<void>(
+      "io_wait",
+      [](IO io, int events) {
+        return static_cast<int>(io.wait(static_cast<IO::Events>(events)));
+      },
+      arg<IO>, arg<int>);
+#ifdef RCX_GVL_STATS
+  mTest.define_method("test_gvl_stats", &Test::test_gvl_stats);
+#endif
+#ifdef RCX_METHOD_STATS
+  mTest.define_singleton_method("method_stats", [](Value) { return rcx::method_stats(); });
+#endif
+#ifdef RCX_URING
+  mTest.define_method("test_uring", &Test::test_uring);
+  mTest.define_singleton_method<void>(
+      "uring_read", [](Array requests) { return rcx::uring::read(requests); }, arg<Array>);
+#endif
 
   cBase = ruby.define_class<Base>("Base")
               .define_constructor(arg<String, "string">)
@@ -585,16 +1295,52 @@ extern "C" void Init_test() {
               .define_method_const("virtual_1", &Base::virtual_1)
               .define_method_const("cxx_exception", &Base::cxx_exception)
               .define_method_const("cxx_exception_unknown", &Base::cxx_exception_unknown)
+              .define_method_const("cxx_exception_mapped", &Base::cxx_exception_mapped)
+              .define_method_const(
+                  "cxx_exception_mapped_non_std", &Base::cxx_exception_mapped_non_std)
+              .define_method_const(
+                  "cxx_exception_mapped_arity", &Base::cxx_exception_mapped_arity)
+              .define_method_const("cxx_exception_deferred", &Base::cxx_exception_deferred,
+                  arg<int>, arg<std::string_view>)
               .define_method_const("ruby_exception", &Base::ruby_exception, arg<Exception>)
               .define_method_const("ruby_exception_format", &Base::ruby_exception_format,
                   arg<ClassT<Exception>>, arg<String>)
               .define_method_const("with_block", &Base::with_block, arg<Value>, block)
-              .define_method_const("with_block_opt", &Base::with_block_opt, arg<Value>, block_opt);
+              .define_method_const("with_block_opt", &Base::with_block_opt, arg<Value>, block_opt)
+              .define_method_const("with_yield", &Base::with_yield, arg<Value>, yield_block)
+              .define_method_const(
+                  "with_yield_opt", &Base::with_yield_opt, arg<Value>, yield_block_opt);
+
+  auto const cMappedError =
+      ruby.define_class<Exception>("MappedError", rcx::builtin::StandardError);
+  rcx::map_exception<MappedError>(cMappedError);
+  rcx::map_exception<MappedNonStdError>(rcx::builtin::ArgumentError);
+  auto const cMappedArityError =
+      ruby.define_class<Exception>("MappedArityError", rcx::builtin::StandardError);
+  cMappedArityError.send("class_eval", "def initialize(a, b) = super(\"#{a} #{b}\")"_str);
+  rcx::map_exception<MappedArityError>(cMappedArityError);
 
   cDerived = ruby.define_class<Derived>("Derived", *cBase)
                  .define_copy_constructor()
                  .define_constructor(arg<String, "string">);
 
+  ruby.set_ractor_safe(true);
+  [[maybe_unused]]
+  auto cAttributes = ruby.define_class<Attributes>("Attributes")
+                         .define_constructor()
+                         .define_attr_accessor<&Attributes::integer>("integer")
+                         .define_attr_reader<&Attributes::real>("real")
+                         .define_attr_writer<&Attributes::real>("real")
+                         .define_attr_accessor<&Attributes::optional>("optional"_sym)
+                         .define_singleton_method<void>(
+                             "describe",
+                             [](Mode mode) {
+                               return rcx::Array::new_from(
+                                   {"rcx_ractor_describe"_fstr, rcx::into_Value(mode)});
+                             },
+                             arg<Mode>);
+  ruby.set_ractor_safe(false);
+
   [[maybe_unused]]
   auto cAssociated = ruby.define_class<Associated>("Associated")
                          .define_constructor()
@@ -17,6 +17,10 @@ struct Test {
   static Value test_nil(Value self);
   static Value test_primitive(Value self);
   static Value test_string(Value self);
+  static Value test_symbol(Value self);
+  static Value test_enum(Value self);
+  static Value test_proc(Value self);
+  static Value test_enumerate(Value self);
   static Value test_class(Value self);
   static Value test_ivar(Value self);
   static Value test_const(Value self);
@@ -31,9 +35,70 @@ struct Test {
   static Value test_exception(Value self);
   static Value test_io(Value self);
   static Value test_gvl(Value self);
+#ifdef RCX_GVL_STATS
+  static Value test_gvl_stats(Value self);
+#endif
+  static Value test_scan(Value self);
+#ifdef RCX_URING
+  static Value test_uring(Value self);
+#endif
   static Value test_optional(Value self);
 };
 
+enum class Mode {
+  Fast,
+  Balanced,
+  Small,
+  Unnamed,
+};
+
+template <> struct rcx::EnumTraits<Mode> {
+  static constexpr std::array symbols{
+    std::pair{Mode::Fast, "fast"},
+    std::pair{Mode::Balanced, "balanced"},
+    std::pair{Mode::Small, "small"},
+  };
+};
+
+// The names of this enum are first created as dynamic Symbols by test_enum.
+enum class Level {
+  Low,
+  High,
+};
+
+template <> struct rcx::EnumTraits<Level> {
+  static constexpr std::array symbols{
+    std::pair{Level::Low, "rcx_test_level_low"},
+    std::pair{Level::High, "rcx_test_level_high"},
+  };
+};
+
+// Counts how many times it is formatted.
+struct CountedFormat {
+  static inline int count = 0;
+};
+
+template <> struct std::formatter<CountedFormat, char> {
+  template <typename ParseContext> constexpr ParseContext::iterator parse(ParseContext &ctx) {
+    return ctx.begin();
+  }
+  template <typename FormatContext>
+  FormatContext::iterator format(CountedFormat, FormatContext &ctx) const {
+    ++CountedFormat::count;
+    return std::format_to(ctx.out(), "counted");
+  }
+};
+
+struct MappedError: std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+struct MappedNonStdError {};
+
+struct MappedArityError: std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
 class Base: public WrappedStruct<> {
   std::string string_;
   int integer_;
@@ -46,10 +111,16 @@ public:
   virtual String virtual_1() const;
   void cxx_exception() const;
   void cxx_exception_unknown() const;
+  void cxx_exception_mapped() const;
+  void cxx_exception_mapped_non_std() const;
+  void cxx_exception_mapped_arity() const;
+  void cxx_exception_deferred(int n, std::string_view s) const;
   void ruby_exception(Exception e) const;
   void ruby_exception_format(ClassT<Exception> e, String s) const;
   Value with_block(Value x, rcx::Proc block) const;
   Value with_block_opt(Value x, std::optional<rcx::Proc> block) const;
+  Value with_yield(Value x, rcx::Yielder block) const;
+  Value with_yield_opt(Value x, std::optional<rcx::Yielder> block) const;
 };
 
 class Derived: public Base {
@@ -58,6 +129,12 @@ public:
   String virtual_1() const override;
 };
 
+struct Attributes: public WrappedStruct<>, public FrozenShareable {
+  int integer = 0;
+  double real = 0;
+  std::optional<int> optional;
+};
+
 class Associated: public WrappedStruct<TwoWayAssociation> {
 public:
   Associated &return_self();
@@ -1,6 +1,7 @@
 # SPDX-License-Identifier: BSL-1.0
 # SPDX-FileCopyrightText: Copyright 2024-2025 Kasumi Hanazuki <kasumi@rollingapple.net>
 require 'test.so'
+require 'tempfile'
 
 RSpec.describe RCX do
   it "has a version number" do
@@ -73,6 +74,10 @@ RSpec.describe 'test ext' do
       expect { obj.string = 'hi again' }.to raise_error FrozenError
     end
 
+    specify 'uninitialized' do
+      expect { Base.allocate.string }.to raise_error(RuntimeError, /not yet initialized/)
+    end
+
     specify 'inheritance' do
       derived = Derived.new('hello')
       aggregate_failures do
@@ -82,6 +87,62 @@ RSpec.describe 'test ext' do
       end
     end
 
+    specify 'attributes' do
+      obj = Attributes.new
+      expect(obj.integer).to eq 0
+      expect(obj.real).to eq 0.0
+      expect(obj.optional).to be_nil
+
+      obj.integer = 42
+      obj.real = 1.5
+      obj.optional = 3
+      expect(obj.integer).to eq 42
+      expect(obj.real).to eq 1.5
+      expect(obj.optional).to eq 3
+
+      expect { obj.integer = 'x' }.to raise_error TypeError
+      expect(obj.integer).to eq 42
+
+      obj.freeze
+      expect(obj.integer).to eq 42
+      expect { obj.integer = 1 }.to raise_error FrozenError
+    end
+
+    specify 'method stats' do
+      skip 'RCX_METHOD_STATS is not enabled' unless Test.respond_to?(:method_stats)
+
+      before = Test.method_stats.fetch('Associated#return_self', {calls: 0})
+      obj = Associated.new
+      3.times { obj.return_self }
+      Associated.swap([obj, obj])
+
+      stats = Test.method_stats
+      expect(stats['Associated#return_self'][:calls]).to eq before[:calls] + 3
+      expect(stats['Associated#return_self'][:histogram].sum).to eq stats['Associated#return_self'][:calls]
+      expect(stats['Associated#return_self'][:time]).to be > 0
+      expect(stats['Associated.swap'][:calls]).to be >= 1
+      expect(stats['Associated#initialize'][:calls]).to be >= 1
+    end
+
+    specify 'Ractor-shareable' do
+      obj = Attributes.new
+      obj.integer = 42
+      expect(Ractor.shareable?(obj)).to be false
+
+      Ractor.make_shareable(obj)
+      expect(Ractor.shareable?(obj)).to be true
+      expect(Ractor.new(obj) { |o| o.integer }.take).to eq 42
+    end
+
+    specify 'Ractor-safe caches' do
+      ractors = 4.times.map do
+        Ractor.new { 100.times.map { Attributes.describe(:small) }.uniq }
+      end
+      ractors.each do |r|
+        expect(r.take).to eq [['rcx_ractor_describe', :small]]
+      end
+    end
+
     describe 'two-way associatetion' do
       specify 'GC safety' do
         arr = 20.times.map { Associated.new }
@@ -118,6 +179,22 @@ RSpec.describe 'test ext' do
       expect { obj.cxx_exception_unknown }.to raise_error(RuntimeError, /\Aint/)
     end
 
+    specify 'throw mapped C++ exception' do
+      obj = Base.new('hello')
+      expect { obj.cxx_exception_mapped }.to raise_error(MappedError, 'pui')
+      expect { obj.cxx_exception_mapped_non_std }.to raise_error(ArgumentError)
+    end
+
+    specify 'throw mapped C++ exception whose class cannot be instantiated' do
+      obj = Base.new('hello')
+      expect { obj.cxx_exception_mapped_arity }.to raise_error(ArgumentError, /wrong number of arguments/)
+    end
+
+    specify 'throw deferred exception' do
+      obj = Base.new('hello')
+      expect { obj.cxx_exception_deferred(42, 'pui') }.to raise_error(ArgumentError, 'deferred 42 pui')
+    end
+
     specify 'throw RubyError' do
       obj = Base.new('hello')
       expect { obj.ruby_exception(RangeError.new('pui')) }.to raise_error(RangeError, 'pui')
@@ -154,6 +231,20 @@ RSpec.describe 'test ext' do
       expect(obj.with_block_opt('A', &:succ)).to eq 'B'
     end
 
+    specify 'yield block' do
+      obj = Base.new('hello')
+
+      expect(obj.with_yield('A') {|x, y| [x, y] }).to eq ['A', 'A']
+      expect { obj.with_yield('A') }.to raise_error(LocalJumpError)
+    end
+
+    specify 'optional yield block' do
+      obj = Base.new('hello')
+
+      expect(obj.with_yield_opt('A')).to eq 'A'
+      expect(obj.with_yield_opt('A', &:succ)).to eq 'B'
+    end
+
     specify 'clone' do
       obj = Base.new('hello')
       obj2 = obj.clone
@@ -168,4 +259,133 @@ RSpec.describe 'test ext' do
       expect(obj3.string).to eq 'obj3'
     end
   end
+
+  describe 'writev' do
+    specify 'writing a shared frozen String from two threads' do
+      fragment = -"fragment\n"
+      r, w = IO.pipe
+      begin
+        loop { w.write_nonblock('x' * 4096) }
+      rescue IO::WaitWritable
+      end
+
+      # Blocks on the full pipe while writing the fragment without the GVL.
+      blocked = Thread.new { Test.writev(w, [fragment]) }
+      Thread.pass until blocked.status == 'sleep'
+
+      Tempfile.create('rcx') do |file|
+        expect(Test.writev(file, [fragment])).to eq 9
+      end
+
+      drained = Thread.new { r.read }
+      expect(blocked.value).to eq 9
+      w.close
+      expect(drained.value.end_with?(fragment)).to be true
+    ensure
+      r&.close
+      w&.close
+    end
+  end
+
+  describe 'split' do
+    specify 'splitting a shared frozen String from threads' do
+      # Large enough to be scanned without the GVL.
+      chunk = -("line\n" * 100_000)
+      threads = 4.times.map do
+        Thread.new { 20.times.map { Test.split(chunk).size } }
+      end
+      expect(threads.flat_map(&:value)).to all(eq 100_000)
+    end
+  end
+
+  describe 'fiber scheduler' do
+    let(:scheduler) do
+      Class.new do
+        attr_reader :calls
+        attr_accessor :result
+
+        def initialize = @calls = []
+        def block(...) = raise(NotImplementedError)
+        def unblock(...) = nil
+        def kernel_sleep(...) = nil
+
+        def io_wait(io, events, timeout)
+          @calls << [:io_wait, events, timeout]
+          result
+        end
+
+        def io_pread(io, buffer, from, length, offset)
+          @calls << [:io_pread, from, length]
+          result
+        end
+
+        def io_pwrite(io, buffer, from, length, offset)
+          @calls << [:io_pwrite, from, length]
+          result
+        end
+      end.new
+    end
+
+    # Runs the block in a non-blocking Fiber of a Thread with the scheduler.
+    def with_scheduler(&block)
+      Thread.new do
+        Fiber.set_scheduler(scheduler)
+        Fiber.new do
+          block.call
+        rescue => e
+          e
+        end.resume
+      end.value
+    end
+
+    specify 'pread_into and pwrite_from' do
+      Tempfile.create('rcx') do |file|
+        buffer = IO::Buffer.new(8)
+
+        scheduler.result = 5
+        expect(with_scheduler { Test.pread_into(file, buffer, 3) }).to eq 5
+        expect(with_scheduler { Test.pwrite_from(file, buffer, 7) }).to eq 5
+        expect(scheduler.calls).to eq [[:io_pread, 3, 8], [:io_pwrite, 7, 8]]
+
+        scheduler.result = -Errno::EBADF::Errno
+        expect(with_scheduler { Test.pread_into(file, buffer, 0) }).to be_a Errno::EBADF
+        expect(with_scheduler { Test.pwrite_from(file, buffer, 0) }).to be_a Errno::EBADF
+        expect(file.size).to eq 0
+      end
+    end
+
+    specify 'io_wait' do
+      r, w = IO.pipe
+      scheduler.result = IO::READABLE
+      expect(with_scheduler { Test.io_wait(r, IO::READABLE) }).to eq IO::READABLE
+      scheduler.result = false
+      expect(with_scheduler { Test.io_wait(r, IO::READABLE) }).to eq 0
+      expect(scheduler.calls).to eq [[:io_wait, IO::READABLE, nil]] * 2
+    ensure
+      r&.close
+      w&.close
+    end
+  end
+
+  describe 'io_uring' do
+    before do
+      skip 'io_uring is not enabled' unless Test.respond_to?(:uring_read)
+    end
+
+    specify 'interrupting a read' do
+      r, w = IO.pipe
+      buffer = IO::Buffer.new(4)
+      th = Thread.new { Test.uring_read([[r, buffer, 0]]) }
+      sleep 0.1
+      th.kill
+      expect(th.join(5)).to be th
+
+      w.write('ping')
+      expect(Test.uring_read([[r, buffer, 0]])).to eq [4]
+      expect(buffer.get_string).to eq 'ping'
+    ensure
+      r&.close
+      w&.close
+    end
+  end
 end